@@ -0,0 +1,297 @@
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/camera.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Default benchmark values
+const unsigned int BENCHMARK_FRAMES        = 600;
+const unsigned int BENCHMARK_WARMUP_FRAMES = 30;   // rendered but not measured, lets lazy driver work settle
+const float BENCHMARK_TOLERANCE            = 0.15f;
+
+
+// command line options; see ParseArguments
+struct BenchmarkOptions {
+    bool Enabled = false;
+    bool UseEGL = false;       // --egl: create the context through EGL instead of GLX/WGL
+    bool Headless = false;     // --headless: no display server at all (GLFW null platform + OSMesa)
+    unsigned int Frames = BENCHMARK_FRAMES;
+    int Width = 1280;
+    int Height = 720;
+    std::string Output = "benchmark.json";
+    std::string Baseline;      // empty: no comparison
+    float Tolerance = BENCHMARK_TOLERANCE;
+    std::string DebugView;     // --debug-view overdraw|lights|mip: render and report that heatmap, see DebugViews
+    bool DepthPrepass = false; // --depth-prepass: the forward paths render depth first
+
+    // --benchmark [--frames N] [--size WxH] [--output file] [--baseline file] [--tolerance 0.15] [--egl] [--headless]
+    // [--debug-view name] [--depth-prepass]
+    void ParseArguments(int argc, char **argv)
+    {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--benchmark")
+                Enabled = true;
+            else if (arg == "--egl")
+                UseEGL = true;
+            else if (arg == "--headless")
+                Headless = true;
+            else if (arg == "--frames" && hasValue)
+                Frames = std::max(1, std::atoi(argv[++i]));
+            else if (arg == "--size" && hasValue)
+                std::sscanf(argv[++i], "%dx%d", &Width, &Height);
+            else if (arg == "--output" && hasValue)
+                Output = argv[++i];
+            else if (arg == "--baseline" && hasValue)
+                Baseline = argv[++i];
+            else if (arg == "--tolerance" && hasValue)
+                Tolerance = (float) std::atof(argv[++i]);
+            else if (arg == "--debug-view" && hasValue)
+                DebugView = argv[++i];
+            else if (arg == "--depth-prepass")
+                DepthPrepass = true;
+        }
+    }
+};
+
+// a point of the scripted camera path
+struct CameraKey {
+    glm::vec3 Position;
+    float Yaw;
+    float Pitch;
+};
+
+// Scripted fly-through of the scene; t in [0, 1] covers the whole path. Keys are interpolated with a
+// Catmull-Rom spline so the camera moves smoothly and every run sees exactly the same frames.
+class CameraPath
+{
+public:
+    std::vector<CameraKey> Keys;
+
+    CameraPath()
+    {
+        Keys = {
+                {glm::vec3(0.0f, 0.5f, 6.0f), -90.0f, -5.0f},
+                {glm::vec3(-4.0f, 0.0f, 3.0f), -70.0f, 0.0f},
+                {glm::vec3(-6.0f, 1.5f, -2.0f), -40.0f, -10.0f},
+                {glm::vec3(-1.0f, 0.5f, -4.0f), -120.0f, -5.0f},
+                {glm::vec3(5.0f, 2.0f, -1.0f), -160.0f, -15.0f},
+                {glm::vec3(8.0f, 0.5f, 5.0f), -130.0f, 0.0f},
+                {glm::vec3(0.0f, 0.5f, 6.0f), -90.0f, -5.0f}
+        };
+    }
+
+    void Apply(Camera &camera, float t) const
+    {
+        t = std::min(std::max(t, 0.0f), 1.0f) * (Keys.size() - 1);
+        int i = std::min((int) t, (int) Keys.size() - 2);
+        float f = t - i;
+        const CameraKey &k0 = Keys[std::max(i - 1, 0)];
+        const CameraKey &k1 = Keys[i];
+        const CameraKey &k2 = Keys[i + 1];
+        const CameraKey &k3 = Keys[std::min(i + 2, (int) Keys.size() - 1)];
+
+        camera.Position = catmullRom(k0.Position, k1.Position, k2.Position, k3.Position, f);
+        camera.PreviousPosition = camera.Position;
+        camera.SetOrientation(catmullRom(k0.Yaw, k1.Yaw, k2.Yaw, k3.Yaw, f),
+                              catmullRom(k0.Pitch, k1.Pitch, k2.Pitch, k3.Pitch, f));
+    }
+
+private:
+    template <typename T>
+    static T catmullRom(const T &p0, const T &p1, const T &p2, const T &p3, float t)
+    {
+        float t2 = t * t, t3 = t2 * t;
+        return ((p1 * 2.0f) + (p2 - p0) * t + (p0 * 2.0f - p1 * 5.0f + p2 * 4.0f - p3) * t2 +
+                (p1 * 3.0f - p0 - p2 * 3.0f + p3) * t3) * 0.5f;
+    }
+};
+
+// Collects per-frame measurements of a benchmark run and reports them as JSON.
+class BenchmarkReport
+{
+public:
+    std::vector<float> FrameMs;
+    unsigned long long DrawCalls = 0;
+    unsigned long long Triangles = 0;
+    // aggregates of a debug view heatmap, reported as <key>_mean and <key>_max when any frame had one
+    std::string ShadingKey;
+    double ShadingMeanSum = 0.0;
+    float ShadingMax = 0.0f;
+    unsigned int ShadingFrames = 0;
+
+    void AddFrame(float ms, unsigned int drawCalls, unsigned long long triangles)
+    {
+        FrameMs.push_back(ms);
+        DrawCalls += drawCalls;
+        Triangles += triangles;
+    }
+
+    // key names the view (e.g. "overdraw"); mean and max are the frame's per-pixel aggregates
+    void AddShading(const std::string &key, float mean, float max)
+    {
+        ShadingKey = key;
+        ShadingMeanSum += mean;
+        ShadingMax = std::max(ShadingMax, max);
+        ShadingFrames++;
+    }
+
+    // mean of the frames' per-pixel means
+    float ShadingMean() const
+    {
+        return ShadingFrames > 0 ? (float) (ShadingMeanSum / ShadingFrames) : 0.0f;
+    }
+
+    // nearest-rank percentile, p in [0, 100]
+    float Percentile(float p) const
+    {
+        if (FrameMs.empty())
+            return 0.0f;
+        std::vector<float> sorted(FrameMs);
+        std::sort(sorted.begin(), sorted.end());
+        size_t rank = (size_t) std::ceil(p / 100.0f * sorted.size());
+        return sorted[std::min(std::max(rank, (size_t) 1), sorted.size()) - 1];
+    }
+
+    float Mean() const
+    {
+        float sum = 0.0f;
+        for (float ms : FrameMs)
+            sum += ms;
+        return FrameMs.empty() ? 0.0f : sum / FrameMs.size();
+    }
+
+    // renderer is the GL_RENDERER string; CompareWithBaseline only compares frame times of the same renderer
+    bool Write(const std::string &path, const std::string &renderer, int width, int height) const
+    {
+        std::ofstream out(path);
+        if (!out) {
+            std::cout << "ERROR::BENCHMARK:: Could not write " << path << std::endl;
+            return false;
+        }
+        size_t frames = std::max(FrameMs.size(), (size_t) 1);
+        out << "{\n"
+            << "  \"renderer\": \"" << escape(renderer) << "\",\n"
+            << "  \"width\": " << width << ",\n"
+            << "  \"height\": " << height << ",\n"
+            << "  \"frames\": " << FrameMs.size() << ",\n"
+            << "  \"min_ms\": " << Percentile(0.0f) << ",\n"
+            << "  \"median_ms\": " << Percentile(50.0f) << ",\n"
+            << "  \"p95_ms\": " << Percentile(95.0f) << ",\n"
+            << "  \"p99_ms\": " << Percentile(99.0f) << ",\n"
+            << "  \"mean_ms\": " << Mean() << ",\n"
+            << "  \"max_ms\": " << Percentile(100.0f) << ",\n"
+            << "  \"draw_calls\": " << DrawCalls / frames << ",\n"
+            << "  \"triangles\": " << Triangles / frames;
+        if (ShadingFrames > 0)
+            out << ",\n"
+                << "  \"" << ShadingKey << "_mean\": " << ShadingMean() << ",\n"
+                << "  \"" << ShadingKey << "_max\": " << ShadingMax;
+        out << "\n}\n";
+        return true;
+    }
+
+    // compares this run against a report written earlier; returns false if any metric regressed by more than
+    // the tolerance (a fraction, 0.15 = 15 %). Frame times of another renderer say nothing about a regression, so
+    // when the baseline was recorded on a different one only the draw call and triangle counts are compared.
+    bool CompareWithBaseline(const std::string &path, const std::string &renderer, float tolerance) const
+    {
+        std::ifstream in(path);
+        if (!in) {
+            std::cout << "ERROR::BENCHMARK:: Could not read baseline " << path << std::endl;
+            return false;
+        }
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        std::string baseline = buffer.str();
+        size_t frames = std::max(FrameMs.size(), (size_t) 1);
+
+        std::string baselineRenderer;
+        bool sameRenderer = !readString(baseline, "renderer", baselineRenderer) || baselineRenderer == escape(renderer);
+        if (!sameRenderer)
+            std::cout << "BENCHMARK:: Baseline was recorded on " << baselineRenderer << ", not " << renderer
+                      << "; frame times skipped" << std::endl;
+
+        bool passed = true;
+        if (sameRenderer) {
+            passed &= check("median_ms", Percentile(50.0f), baseline, tolerance);
+            passed &= check("p95_ms", Percentile(95.0f), baseline, tolerance);
+            passed &= check("p99_ms", Percentile(99.0f), baseline, tolerance);
+        }
+        passed &= check("draw_calls", (double) (DrawCalls / frames), baseline, tolerance);
+        passed &= check("triangles", (double) (Triangles / frames), baseline, tolerance);
+        if (ShadingFrames > 0) {
+            passed &= check(ShadingKey + "_mean", ShadingMean(), baseline, tolerance);
+            passed &= check(ShadingKey + "_max", ShadingMax, baseline, tolerance);
+        }
+        return passed;
+    }
+
+private:
+    static bool check(const std::string &key, double value, const std::string &baseline, float tolerance)
+    {
+        double reference;
+        if (!readNumber(baseline, key, reference)) {
+            std::cout << "BENCHMARK:: " << key << " missing from baseline, skipped" << std::endl;
+            return true;
+        }
+        double limit = reference * (1.0 + tolerance);
+        bool passed = value <= limit;
+        std::cout << "BENCHMARK:: " << key << ": " << value << " (baseline " << reference << ", limit " << limit << ") "
+                  << (passed ? "ok" : "REGRESSION") << std::endl;
+        return passed;
+    }
+
+    // the report is flat JSON written by Write, so a key lookup is all the parsing needed
+    static bool readNumber(const std::string &json, const std::string &key, double &value)
+    {
+        size_t position = json.find("\"" + key + "\"");
+        if (position == std::string::npos)
+            return false;
+        position = json.find(':', position);
+        if (position == std::string::npos)
+            return false;
+        value = std::atof(json.c_str() + position + 1);
+        return true;
+    }
+
+    // the raw (still escaped) contents of a string value
+    static bool readString(const std::string &json, const std::string &key, std::string &value)
+    {
+        size_t position = json.find("\"" + key + "\"");
+        if (position == std::string::npos)
+            return false;
+        position = json.find('"', json.find(':', position));
+        if (position == std::string::npos)
+            return false;
+        size_t end = position + 1;
+        while (end < json.size() && json[end] != '"')
+            end += json[end] == '\\' ? 2 : 1;
+        value = json.substr(position + 1, std::min(end, json.size()) - position - 1);
+        return true;
+    }
+
+    static std::string escape(const std::string &text)
+    {
+        std::string result;
+        for (char c : text) {
+            if (c == '"' || c == '\\')
+                result += '\\';
+            result += c;
+        }
+        return result;
+    }
+};
+#endif
@@ -29,6 +29,7 @@ class Camera
 public:
     // camera Attributes
     glm::vec3 Position;
+    glm::vec3 PreviousPosition; // position at the start of the last fixed simulation step, used for interpolation
     glm::vec3 Front;
     glm::vec3 Up;
     glm::vec3 Right;
@@ -45,6 +46,7 @@ public:
     Camera(glm::vec3 position = glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3 up = glm::vec3(0.0f, 1.0f, 0.0f), float yaw = YAW, float pitch = PITCH) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
     {
         Position = position;
+        PreviousPosition = position;
         WorldUp = up;
         Yaw = yaw;
         Pitch = pitch;
@@ -54,6 +56,7 @@ public:
     Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
     {
         Position = glm::vec3(posX, posY, posZ);
+        PreviousPosition = Position;
         WorldUp = glm::vec3(upX, upY, upZ);
         Yaw = yaw;
         Pitch = pitch;
@@ -66,6 +69,13 @@ public:
         return glm::lookAt(Position, Position + Front, Up);
     }
 
+    // returns the view matrix at a point between the previous and the current simulation step (alpha in [0, 1])
+    glm::mat4 GetViewMatrix(float alpha)
+    {
+        glm::vec3 position = PreviousPosition + (Position - PreviousPosition) * alpha;
+        return glm::lookAt(position, position + Front, Up);
+    }
+
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void ProcessKeyboard(Camera_Movement direction, float deltaTime)
     {
@@ -102,6 +112,30 @@ public:
         updateCameraVectors();
     }
 
+    // points the camera in the given direction, e.g. when it is driven by a script instead of the mouse
+    void SetOrientation(float yaw, float pitch)
+    {
+        Yaw = yaw;
+        Pitch = pitch;
+        updateCameraVectors();
+    }
+
+    // points the camera along a direction, e.g. a saved one; Yaw and Pitch follow, so mouse input continues from it
+    void SetFront(const glm::vec3 &front)
+    {
+        float yaw, pitch;
+        OrientationOf(front, yaw, pitch);
+        SetOrientation(yaw, pitch);
+    }
+
+    // the Euler angles updateCameraVectors turns into this direction
+    static void OrientationOf(const glm::vec3 &front, float &yaw, float &pitch)
+    {
+        glm::vec3 direction = glm::normalize(front);
+        yaw = glm::degrees(atan2(direction.z, direction.x));
+        pitch = glm::degrees(asin(glm::clamp(direction.y, -1.0f, 1.0f)));
+    }
+
     // processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
     void ProcessMouseScroll(float yoffset)
     {
@@ -0,0 +1,28 @@
+#ifndef CONTENT_HASH_H
+#define CONTENT_HASH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Default content hash values
+const uint64_t CONTENT_HASH_SEED = 0xcbf29ce484222325ull;   // FNV-1a offset basis
+
+
+// 64 bit FNV-1a, the key of the on-disk caches; chain calls to hash several pieces:
+// ContentHash(b, size, ContentHash(a, size, CONTENT_HASH_SEED))
+inline uint64_t ContentHash(const void *data, size_t size, uint64_t hash = CONTENT_HASH_SEED)
+{
+    const unsigned char *bytes = (const unsigned char *) data;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ull;
+    }
+    return hash;
+}
+
+inline uint64_t ContentHash(const std::string &text, uint64_t hash = CONTENT_HASH_SEED)
+{
+    return ContentHash(text.data(), text.size(), hash);
+}
+#endif
@@ -0,0 +1,185 @@
+#ifndef DEBUG_VIEWS_H
+#define DEBUG_VIEWS_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/render_stats.h>
+#include <learnopengl/resource_registry.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// What the heatmap shows; the value per pixel is written by heatmap.fs.
+enum Debug_View {
+    DEBUG_VIEW_NONE,
+    DEBUG_VIEW_OVERDRAW,      // fragments of the lit models that passed the depth test, additively counted
+    DEBUG_VIEW_LIGHT_COUNT,   // point lights whose radius reaches the visible surface
+    DEBUG_VIEW_MIP_LEVEL      // mip level of the diffuse texture sampled by the visible surface
+};
+
+const char *const DEBUG_VIEW_NAMES[] = {"Off", "Overdraw", "Lights per pixel", "Mip level"};
+const char *const DEBUG_VIEW_KEYS[] = {"none", "overdraw", "lights", "mip"};   // --debug-view and the benchmark report
+const float DEBUG_VIEW_RANGES[] = {1.0f, 8.0f, 16.0f, 10.0f};                  // the value shown as the hottest color
+const int DEBUG_VIEW_COUNT = 4;
+
+
+// Heatmaps of where the fragment work goes. The lit models are drawn a second time with heatmap.fs into a
+// single-channel float target of the scene's size, with the depth state of the lit pass; overdraw adds 1 per
+// fragment through additive blending, the other views keep the nearest surface's value. End reads the target back
+// for the Mean and Max aggregates and replaces the scene image with the heatmap.
+//
+// The readback stalls the pipeline, so frame times taken with a view on measure the view as well.
+class DebugViews
+{
+public:
+    Debug_View View = DEBUG_VIEW_NONE;
+    float Mean = 0.0f;   // over the pixels the models cover
+    float Max = 0.0f;
+    int Width = 0, Height = 0;
+    unsigned int FBO = 0;
+    unsigned int ValueTexture = 0;   // R32F; 0 where no model was drawn, see heatmap.fs
+
+    // parses a DEBUG_VIEW_KEYS name; false for an unknown one
+    static bool FromKey(const std::string &key, Debug_View &view)
+    {
+        for (int i = 0; i < DEBUG_VIEW_COUNT; i++) {
+            if (key == DEBUG_VIEW_KEYS[i]) {
+                view = (Debug_View) i;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void Resize(int width, int height)
+    {
+        width = std::max(width, 1);
+        height = std::max(height, 1);
+        if (width == Width && height == Height)
+            return;
+        Width = width;
+        Height = height;
+
+        if (FBO == 0) {
+            glGenFramebuffers(1, &FBO);
+            glGenTextures(1, &ValueTexture);
+            glGenRenderbuffers(1, &depthRenderbuffer);
+            glGenVertexArrays(1, &quadVAO);
+        }
+        glBindTexture(GL_TEXTURE_2D, ValueTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, Width, Height, 0, GL_RED, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, Width, Height);
+        ResourceRegistry::Get().Track(RESOURCE_TEXTURE, ValueTexture, ResourceRegistry::TextureBytes(Width, Height, 4),
+                                      "Debug view values");
+        ResourceRegistry::Get().Track(RESOURCE_RENDERBUFFER, depthRenderbuffer,
+                                      ResourceRegistry::TextureBytes(Width, Height, 4), "Debug view depth");
+
+        GLint previousFramebuffer;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ValueTexture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Debug view target is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    }
+
+    // redirects rendering into the value target, in the current viewport; draw the models with heatmap.fs (and
+    // the depth prepass, if the lit pass has one) afterwards
+    void Begin()
+    {
+        GLint framebuffer = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+        targetFramebuffer = (unsigned int) framebuffer;
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        const float zero[] = {0.0f, 0.0f, 0.0f, 0.0f};
+        const float farDepth = 1.0f;
+        glClearBufferfv(GL_COLOR, 0, zero);
+        glClearBufferfv(GL_DEPTH, 0, &farDepth);
+        if (View == DEBUG_VIEW_OVERDRAW) {
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+        } else
+            glDisable(GL_BLEND);
+    }
+
+    // computes the aggregates and draws the heatmap over the framebuffer that was bound in Begin
+    void End(Shader &resolveShader)
+    {
+        glDisable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        measure();
+
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+        glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+        glDisable(GL_DEPTH_TEST);
+        resolveShader.use();
+        resolveShader.setInt("values", 0);
+        resolveShader.setFloat("bias", bias());
+        resolveShader.setFloat("range", DEBUG_VIEW_RANGES[View]);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, ValueTexture);
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        RenderStats::Get().AddDraw(3);
+        glBindVertexArray(0);
+        glEnable(GL_DEPTH_TEST);
+    }
+
+    void Destroy()
+    {
+        if (FBO == 0)
+            return;
+        glDeleteVertexArrays(1, &quadVAO);
+        glDeleteRenderbuffers(1, &depthRenderbuffer);
+        glDeleteTextures(1, &ValueTexture);
+        glDeleteFramebuffers(1, &FBO);
+        ResourceRegistry::Get().Untrack(RESOURCE_RENDERBUFFER, depthRenderbuffer);
+        ResourceRegistry::Get().Untrack(RESOURCE_TEXTURE, ValueTexture);
+        FBO = 0;
+        Width = Height = 0;
+    }
+
+private:
+    unsigned int depthRenderbuffer = 0;
+    unsigned int quadVAO = 0;   // empty, deferred_quad.vs builds the triangle from gl_VertexID
+    unsigned int targetFramebuffer = 0;
+    GLint viewport[4] = {0, 0, 0, 0};
+    std::vector<float> values;
+
+    // heatmap.fs writes value + 1 for the views where 0 is a valid value, so 0 still means "no model here"
+    float bias() const
+    {
+        return View == DEBUG_VIEW_OVERDRAW ? 0.0f : 1.0f;
+    }
+
+    void measure()
+    {
+        values.resize((size_t) viewport[2] * viewport[3]);
+        glReadBuffer(GL_COLOR_ATTACHMENT0);
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(viewport[0], viewport[1], viewport[2], viewport[3], GL_RED, GL_FLOAT, values.data());
+
+        double sum = 0.0;
+        size_t covered = 0;
+        Max = 0.0f;
+        for (float value : values) {
+            if (value <= 0.0f)
+                continue;
+            value -= bias();
+            sum += value;
+            covered++;
+            Max = std::max(Max, value);
+        }
+        Mean = covered > 0 ? (float) (sum / covered) : 0.0f;
+    }
+};
+#endif
@@ -0,0 +1,347 @@
+#ifndef DEFERRED_RENDERER_H
+#define DEFERRED_RENDERER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/lights.h>
+#include <learnopengl/render_stats.h>
+#include <learnopengl/resource_registry.h>
+#include <learnopengl/shader.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+// Default deferred renderer values
+const unsigned int LIGHT_VOLUME_SLICES = 16;
+const unsigned int LIGHT_VOLUME_STACKS = 12;
+
+
+// Deferred shading: the models are rasterized once into a G-buffer (albedo + specular, normal, depth/stencil), then
+// every light is accumulated only where it can contribute. Point lights are drawn as spheres of their attenuation
+// radius; a stencil pass per light marks the pixels whose surface lies inside the sphere, so the lighting shader
+// runs for those pixels only, whatever the overdraw of the scene was.
+//
+// The G-buffer is allocated at the full framebuffer size and rendered into the current viewport, so it follows
+// DynamicResolution's scaled rendering without reallocating.
+//
+// The light passes depth-test and write stencil against DepthTexture while their shaders need the scene depth, so
+// that is blitted into DepthCopyTexture after the geometry pass; sampling an attached image would be a feedback loop.
+class DeferredRenderer
+{
+public:
+    int Width, Height;
+    unsigned int FBO;
+    unsigned int AlbedoSpecTexture;   // RGBA8: albedo, specular intensity in alpha
+    unsigned int NormalTexture;       // RGB16F
+    unsigned int DepthTexture;        // DEPTH24_STENCIL8, also holds the light volume stencil counts
+    unsigned int DepthCopyTexture;    // DEPTH24_STENCIL8, the scene depth the light passes sample
+    unsigned int LightTexture;        // RGBA16F light accumulation, the final color
+
+    DeferredRenderer()
+        : Width(0), Height(0), FBO(0), AlbedoSpecTexture(0), NormalTexture(0), DepthTexture(0), DepthCopyTexture(0),
+          LightTexture(0), depthCopyFBO(0), sphereVAO(0), sphereVBO(0), sphereEBO(0), sphereIndexCount(0), quadVAO(0), targetFramebuffer(0)
+    {
+        std::fill(viewport, viewport + 4, 0);
+    }
+
+    void Resize(int width, int height)
+    {
+        width = std::max(width, 1);
+        height = std::max(height, 1);
+        if (width == Width && height == Height)
+            return;
+        Width = width;
+        Height = height;
+
+        if (FBO == 0) {
+            glGenFramebuffers(1, &FBO);
+            glGenTextures(1, &AlbedoSpecTexture);
+            glGenTextures(1, &NormalTexture);
+            glGenTextures(1, &DepthTexture);
+            glGenTextures(1, &DepthCopyTexture);
+            glGenTextures(1, &LightTexture);
+            glGenFramebuffers(1, &depthCopyFBO);
+            createLightVolume();
+            glGenVertexArrays(1, &quadVAO);
+        }
+        allocate(AlbedoSpecTexture, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, 4, "G-buffer albedo");
+        allocate(NormalTexture, GL_RGB16F, GL_RGB, GL_FLOAT, 6, "G-buffer normal");
+        allocate(DepthTexture, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4, "G-buffer depth");
+        allocate(DepthCopyTexture, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4, "G-buffer depth copy");
+        allocate(LightTexture, GL_RGBA16F, GL_RGBA, GL_FLOAT, 8, "Deferred light accumulation");
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, AlbedoSpecTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, NormalTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, LightTexture, 0);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, DepthTexture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: G-buffer is not complete!" << std::endl;
+
+        // blit target only, the same format as DepthTexture so depth can be copied
+        glBindFramebuffer(GL_FRAMEBUFFER, depthCopyFBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, DepthCopyTexture, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: G-buffer depth copy is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // redirects rendering into the G-buffer; draw the models with gbuffer.fs afterwards. The framebuffer and
+    // viewport bound at this point receive the result in Resolve.
+    void BeginGeometry(const glm::vec3 &clearColor)
+    {
+        GLint framebuffer = 0;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &framebuffer);
+        targetFramebuffer = (unsigned int) framebuffer;
+        glGetIntegerv(GL_VIEWPORT, viewport);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        const GLenum all[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2};
+        glDrawBuffers(3, all);
+        const float zero[] = {0.0f, 0.0f, 0.0f, 0.0f};
+        const float background[] = {clearColor.r, clearColor.g, clearColor.b, 1.0f};
+        glClearBufferfv(GL_COLOR, 0, zero);
+        glClearBufferfv(GL_COLOR, 1, zero);
+        glClearBufferfv(GL_COLOR, 2, background);
+        glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+
+        const GLenum geometry[] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_NONE};
+        glDrawBuffers(3, geometry);
+        glDisable(GL_BLEND);
+    }
+
+    // accumulates the directional light and every point light into LightTexture
+    void Lighting(Shader &dirShader, Shader &pointShader, Shader &stencilShader, const glm::mat4 &view,
+                  const glm::mat4 &projection, const glm::vec3 &viewPosition, float shininess, const DirLight &dirLight,
+                  const std::vector<PointLight> &lights)
+    {
+        glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+        glm::vec2 viewportSize((float) viewport[2], (float) viewport[3]);
+        copyDepth();
+        glDrawBuffer(GL_COLOR_ATTACHMENT2);
+        glDepthMask(GL_FALSE);
+        bindGBuffer();
+
+        // surfaces covered by the G-buffer get ambient + directional light; the background keeps the clear color
+        glDisable(GL_DEPTH_TEST);
+        dirShader.use();
+        setGBufferUniforms(dirShader, inverseViewProjection, viewportSize);
+        dirShader.setVec3("dirLight.direction", dirLight.direction);
+        dirShader.setVec3("dirLight.ambient", dirLight.ambient);
+        dirShader.setVec3("dirLight.diffuse", dirLight.diffuse);
+        dirShader.setVec3("dirLight.specular", dirLight.specular);
+        dirShader.setVec3("viewPosition", viewPosition);
+        dirShader.setFloat("shininess", shininess);
+        glBindVertexArray(quadVAO);
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+        RenderStats::Get().AddDraw(3);
+
+        pointShader.use();
+        setGBufferUniforms(pointShader, inverseViewProjection, viewportSize);
+        pointShader.setVec3("viewPosition", viewPosition);
+        pointShader.setFloat("shininess", shininess);
+        stencilShader.use();
+        stencilShader.setMat4("view", view);
+        stencilShader.setMat4("projection", projection);
+        pointShader.use();
+        pointShader.setMat4("view", view);
+        pointShader.setMat4("projection", projection);
+
+        glEnable(GL_STENCIL_TEST);
+        glBlendFunc(GL_ONE, GL_ONE);
+        glBindVertexArray(sphereVAO);
+        for (const PointLight &light : lights) {
+            float radius = LightRadius(light);
+            if (radius <= 0.0f)
+                continue;
+            // the polygonal sphere lies inside the true one, scale it so it encloses the whole radius
+            glm::mat4 model = glm::translate(glm::mat4(1.0f), light.position);
+            model = glm::scale(model, glm::vec3(radius * volumeScale()));
+
+            // stencil pass: back faces behind the surface count up, front faces behind it count down, which leaves
+            // a non-zero count exactly where the surface is inside the sphere; works with the camera inside too
+            stencilShader.use();
+            stencilShader.setMat4("model", model);
+            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+            glEnable(GL_DEPTH_TEST);
+            glDepthFunc(GL_LESS);
+            glDisable(GL_CULL_FACE);
+            glDisable(GL_BLEND);
+            glStencilFunc(GL_ALWAYS, 0, 0xff);
+            glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+            glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+            glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+            RenderStats::Get().AddDraw(sphereIndexCount);
+
+            // light pass over the marked pixels; back faces so the camera may be inside the volume. Passing pixels
+            // reset their count, which leaves the stencil clear for the next light.
+            pointShader.use();
+            pointShader.setMat4("model", model);
+            pointShader.setVec3("light.position", light.position);
+            pointShader.setVec3("light.ambient", light.ambient);
+            pointShader.setVec3("light.diffuse", light.diffuse);
+            pointShader.setVec3("light.specular", light.specular);
+            pointShader.setFloat("light.constant", light.constant);
+            pointShader.setFloat("light.linear", light.linear);
+            pointShader.setFloat("light.quadratic", light.quadratic);
+            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+            glDisable(GL_DEPTH_TEST);
+            glEnable(GL_CULL_FACE);
+            glCullFace(GL_FRONT);
+            glEnable(GL_BLEND);
+            glStencilFunc(GL_NOTEQUAL, 0, 0xff);
+            glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO);
+            glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0);
+            RenderStats::Get().AddDraw(sphereIndexCount);
+        }
+
+        glBindVertexArray(0);
+        glDisable(GL_STENCIL_TEST);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+        glCullFace(GL_BACK);
+        glDisable(GL_CULL_FACE);
+        glEnable(GL_DEPTH_TEST);
+        glDepthFunc(GL_LESS);
+        glDepthMask(GL_TRUE);
+        glDisable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // copies the lit image and the scene depth into the framebuffer that was bound in BeginGeometry, so forward
+    // geometry (grass, river, skybox) can be drawn on top with correct occlusion
+    void Resolve()
+    {
+        int x = viewport[0], y = viewport[1], w = viewport[2], h = viewport[3];
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glReadBuffer(GL_COLOR_ATTACHMENT2);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targetFramebuffer);
+        glBlitFramebuffer(x, y, x + w, y + h, x, y, x + w, y + h, GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+        glViewport(x, y, w, h);
+    }
+
+    void Destroy()
+    {
+        if (FBO == 0)
+            return;
+        glDeleteVertexArrays(1, &quadVAO);
+        glDeleteVertexArrays(1, &sphereVAO);
+        glDeleteBuffers(1, &sphereVBO);
+        glDeleteBuffers(1, &sphereEBO);
+        unsigned int textures[] = {AlbedoSpecTexture, NormalTexture, DepthTexture, DepthCopyTexture, LightTexture};
+        glDeleteTextures(5, textures);
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteFramebuffers(1, &depthCopyFBO);
+        for (unsigned int texture : textures)
+            ResourceRegistry::Get().Untrack(RESOURCE_TEXTURE, texture);
+        ResourceRegistry::Get().Untrack(RESOURCE_BUFFER, sphereVBO);
+        ResourceRegistry::Get().Untrack(RESOURCE_BUFFER, sphereEBO);
+        FBO = depthCopyFBO = 0;
+    }
+
+private:
+    unsigned int depthCopyFBO;
+    unsigned int sphereVAO, sphereVBO, sphereEBO;
+    unsigned int sphereIndexCount;
+    unsigned int quadVAO;         // empty, deferred_quad.vs builds the triangle from gl_VertexID
+    unsigned int targetFramebuffer;
+    GLint viewport[4];
+
+    void allocate(unsigned int texture, GLint internalFormat, GLenum format, GLenum type, int texelBytes,
+                  const char *name)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, Width, Height, 0, format, type, NULL);
+        ResourceRegistry::Get().Track(RESOURCE_TEXTURE, texture, ResourceRegistry::TextureBytes(Width, Height, texelBytes), name);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    // copies the viewport's depth for the light shaders; leaves the G-buffer bound
+    void copyDepth()
+    {
+        int x = viewport[0], y = viewport[1], w = viewport[2], h = viewport[3];
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, depthCopyFBO);
+        glBlitFramebuffer(x, y, x + w, y + h, x, y, x + w, y + h, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    }
+
+    // gDepth is the copy, nothing attached to the bound framebuffer is sampled
+    void bindGBuffer()
+    {
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, AlbedoSpecTexture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, NormalTexture);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, DepthCopyTexture);
+    }
+
+    static void setGBufferUniforms(Shader &shader, const glm::mat4 &inverseViewProjection, const glm::vec2 &viewportSize)
+    {
+        shader.setInt("gAlbedoSpec", 0);
+        shader.setInt("gNormal", 1);
+        shader.setInt("gDepth", 2);
+        shader.setMat4("inverseViewProjection", inverseViewProjection);
+        shader.setVec2("viewportSize", viewportSize);
+    }
+
+    // ratio between the radius of the circumscribed and of the tessellated sphere
+    static float volumeScale()
+    {
+        const float pi = 3.14159265f;
+        return 1.0f / (std::cos(pi / LIGHT_VOLUME_SLICES) * std::cos(pi / (2.0f * LIGHT_VOLUME_STACKS)));
+    }
+
+    // unit UV sphere
+    void createLightVolume()
+    {
+        const float pi = 3.14159265f;
+        std::vector<float> vertices;
+        for (unsigned int stack = 0; stack <= LIGHT_VOLUME_STACKS; stack++) {
+            float phi = pi * stack / LIGHT_VOLUME_STACKS;
+            for (unsigned int slice = 0; slice <= LIGHT_VOLUME_SLICES; slice++) {
+                float theta = 2.0f * pi * slice / LIGHT_VOLUME_SLICES;
+                vertices.push_back(std::sin(phi) * std::cos(theta));
+                vertices.push_back(std::cos(phi));
+                vertices.push_back(std::sin(phi) * std::sin(theta));
+            }
+        }
+        std::vector<unsigned int> indices;
+        for (unsigned int stack = 0; stack < LIGHT_VOLUME_STACKS; stack++) {
+            for (unsigned int slice = 0; slice < LIGHT_VOLUME_SLICES; slice++) {
+                unsigned int a = stack * (LIGHT_VOLUME_SLICES + 1) + slice;
+                unsigned int b = a + LIGHT_VOLUME_SLICES + 1;
+                // counter-clockwise seen from outside
+                indices.insert(indices.end(), {a, a + 1, b, a + 1, b + 1, b});
+            }
+        }
+        sphereIndexCount = (unsigned int) indices.size();
+
+        glGenVertexArrays(1, &sphereVAO);
+        glGenBuffers(1, &sphereVBO);
+        glGenBuffers(1, &sphereEBO);
+        glBindVertexArray(sphereVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+        ResourceRegistry::Get().Track(RESOURCE_BUFFER, sphereVBO, vertices.size() * sizeof(float), "Light volume vertices");
+        ResourceRegistry::Get().Track(RESOURCE_BUFFER, sphereEBO, indices.size() * sizeof(unsigned int), "Light volume indices");
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glBindVertexArray(0);
+    }
+};
+#endif
@@ -0,0 +1,180 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/resource_registry.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Default dynamic resolution values
+const float GPU_BUDGET_MS          = 12.0f;  // scene time the controller steers towards
+const float MIN_RESOLUTION_SCALE   = 0.5f;
+const float MAX_RESOLUTION_SCALE   = 1.0f;
+const float SCALE_STEP             = 1.0f / 64.0f; // scale changes are quantized to avoid resizing every frame
+const unsigned int TIMER_QUERIES   = 4;      // queries in flight, results are read a few frames late so nothing stalls
+
+
+// Renders the 3D scene into an offscreen framebuffer at a fraction of the window size and upscales it to the
+// default framebuffer. The fraction follows the GPU time of the scene, measured with GL_TIME_ELAPSED queries,
+// towards a configurable budget. The framebuffer is allocated at full window size once and rendered into a
+// sub-rectangle, so scale changes never reallocate anything.
+class DynamicResolution
+{
+public:
+    bool Enabled;
+    bool Adaptive;                  // false keeps Scale fixed, e.g. for benchmarks
+    float TargetMs;
+    float Scale;
+    float LastGpuMs;
+
+    int Width, Height;              // window framebuffer size
+    int RenderWidth, RenderHeight;  // scaled size the scene is rendered at
+
+    unsigned int FBO;
+    unsigned int ColorTexture;
+
+    DynamicResolution(bool enabled = false, float targetMs = GPU_BUDGET_MS)
+        : Enabled(enabled), Adaptive(true), TargetMs(targetMs), Scale(MAX_RESOLUTION_SCALE), LastGpuMs(0.0f), Width(0), Height(0),
+          RenderWidth(0), RenderHeight(0), FBO(0), ColorTexture(0), depthRenderbuffer(0), nextQuery(0), activeQuery(-1)
+    {
+        std::fill(queries, queries + TIMER_QUERIES, 0u);
+        std::fill(pending, pending + TIMER_QUERIES, false);
+    }
+
+    // (re)allocates the offscreen targets when the window framebuffer size changed
+    void Resize(int width, int height)
+    {
+        width = std::max(width, 1);
+        height = std::max(height, 1);
+        if (width == Width && height == Height)
+            return;
+        Width = width;
+        Height = height;
+
+        if (FBO == 0) {
+            glGenFramebuffers(1, &FBO);
+            glGenTextures(1, &ColorTexture);
+            glGenRenderbuffers(1, &depthRenderbuffer);
+            glGenQueries(TIMER_QUERIES, queries);
+        }
+        glBindTexture(GL_TEXTURE_2D, ColorTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, Width, Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, Width, Height);
+        ResourceRegistry::Get().Track(RESOURCE_TEXTURE, ColorTexture, ResourceRegistry::TextureBytes(Width, Height, 4),
+                                      "Dynamic resolution color");
+        ResourceRegistry::Get().Track(RESOURCE_RENDERBUFFER, depthRenderbuffer,
+                                      ResourceRegistry::TextureBytes(Width, Height, 4), "Dynamic resolution depth");
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ColorTexture, 0);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::FRAMEBUFFER:: Dynamic resolution framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // binds the target the scene should be rendered into and starts timing it
+    void Begin()
+    {
+        if (!Enabled) {
+            RenderWidth = Width;
+            RenderHeight = Height;
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            glViewport(0, 0, Width, Height);
+            return;
+        }
+
+        collectQueries();
+        RenderWidth = std::max(1, (int) std::lround(Width * Scale));
+        RenderHeight = std::max(1, (int) std::lround(Height * Scale));
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, RenderWidth, RenderHeight);
+
+        // a slot whose result was not read back yet is skipped rather than waited on
+        activeQuery = pending[nextQuery] ? -1 : (int) nextQuery;
+        if (activeQuery >= 0)
+            glBeginQuery(GL_TIME_ELAPSED, queries[activeQuery]);
+    }
+
+    // stops timing and upscales the rendered scene into the window; later draws (ImGui) go to native resolution
+    void End()
+    {
+        if (!Enabled)
+            return;
+
+        if (activeQuery >= 0) {
+            glEndQuery(GL_TIME_ELAPSED);
+            pending[activeQuery] = true;
+            nextQuery = (nextQuery + 1) % TIMER_QUERIES;
+        }
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, RenderWidth, RenderHeight, 0, 0, Width, Height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, Width, Height);
+    }
+
+    void Destroy()
+    {
+        if (FBO == 0)
+            return;
+        glDeleteQueries(TIMER_QUERIES, queries);
+        glDeleteRenderbuffers(1, &depthRenderbuffer);
+        glDeleteTextures(1, &ColorTexture);
+        glDeleteFramebuffers(1, &FBO);
+        ResourceRegistry::Get().Untrack(RESOURCE_RENDERBUFFER, depthRenderbuffer);
+        ResourceRegistry::Get().Untrack(RESOURCE_TEXTURE, ColorTexture);
+        FBO = 0;
+    }
+
+private:
+    unsigned int depthRenderbuffer;
+    unsigned int queries[TIMER_QUERIES];
+    bool pending[TIMER_QUERIES];
+    unsigned int nextQuery;
+    int activeQuery;
+
+    // reads every finished timer query without blocking and steers the scale towards the budget
+    void collectQueries()
+    {
+        for (unsigned int i = 0; i < TIMER_QUERIES; i++) {
+            unsigned int slot = (nextQuery + i) % TIMER_QUERIES;
+            if (!pending[slot])
+                continue;
+            GLint available = 0;
+            glGetQueryObjectiv(queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                break;  // queries complete in order, later ones cannot be ready either
+            GLuint64 elapsed = 0;
+            glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsed);
+            pending[slot] = false;
+            LastGpuMs = elapsed / 1.0e6f;
+            adjustScale();
+        }
+    }
+
+    void adjustScale()
+    {
+        if (!Adaptive || LastGpuMs <= 0.0f)
+            return;
+        // GPU cost is roughly proportional to the pixel count, i.e. to the square of the scale
+        float desired = Scale * std::sqrt(TargetMs / LastGpuMs);
+        desired = std::min(std::max(desired, MIN_RESOLUTION_SCALE), MAX_RESOLUTION_SCALE);
+        // move only part of the way each time so a single noisy sample does not make the image pump
+        float next = Scale + (desired - Scale) * 0.25f;
+        next = std::round(next / SCALE_STEP) * SCALE_STEP;
+        Scale = std::min(std::max(next, MIN_RESOLUTION_SCALE), MAX_RESOLUTION_SCALE);
+    }
+};
+#endif
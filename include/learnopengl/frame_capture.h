@@ -0,0 +1,202 @@
+#ifndef FRAME_CAPTURE_H
+#define FRAME_CAPTURE_H
+
+#include <learnopengl/pbo_readback.h>
+#include <learnopengl/png_writer.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdio>
+#include <ctime>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Default frame capture values
+const unsigned int CAPTURE_WORKERS         = 2;    // threads encoding PNGs
+const unsigned int CAPTURE_QUEUE_LIMIT     = 8;    // frames waiting for a worker; further sequence frames are dropped
+const unsigned int CAPTURE_SEQUENCE_FRAMES = 300;
+
+
+// Screenshots and frame sequences without hitches: the frame is copied through PboReadback, so the render thread
+// never waits for the GPU, and PNG encoding plus file IO happen on worker threads. The queue between them is
+// bounded; when the workers fall behind, sequence frames are dropped (and counted) instead of letting memory grow.
+// Screenshots are never dropped.
+class FrameCapture
+{
+public:
+    unsigned int SequenceFrames = CAPTURE_SEQUENCE_FRAMES;
+    std::atomic<unsigned int> Saved;
+    unsigned int Dropped = 0;
+
+    FrameCapture() : Saved(0) {}
+
+    ~FrameCapture()
+    {
+        stopWorkers();
+    }
+
+    // captures the next finished frame
+    void Screenshot()
+    {
+        screenshotRequested = true;
+    }
+
+    // captures the next `frames` frames as a numbered sequence, or stops a running one
+    void ToggleSequence(unsigned int frames)
+    {
+        if (sequenceLeft > 0) {
+            sequenceLeft = 0;
+            return;
+        }
+        sequenceName = "sequence_" + timestamp();
+        sequenceLeft = frames;
+        sequenceFrame = 0;
+    }
+
+    unsigned int SequenceLeft() const
+    {
+        return sequenceLeft;
+    }
+
+    // true while captures are requested or in flight; the render loop must keep producing frames until then
+    bool Busy() const
+    {
+        return screenshotRequested || sequenceLeft > 0 || readback.Pending() > 0;
+    }
+
+    unsigned int Queued()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return (unsigned int) queue.size();
+    }
+
+    // call once per frame after everything was drawn into the default framebuffer, before swapping buffers
+    void Update(int width, int height)
+    {
+        collect(false);
+        if (screenshotRequested) {
+            std::string path = "screenshot_" + timestamp() + "_" + std::to_string(nextTag) + ".png";
+            if (request(width, height, path, false))
+                screenshotRequested = false;   // otherwise retried next frame
+        }
+        if (sequenceLeft > 0) {
+            char number[16];
+            std::snprintf(number, sizeof(number), "_%05u.png", sequenceFrame++);
+            if (!request(width, height, sequenceName + number, true))
+                Dropped++;
+            sequenceLeft--;
+        }
+    }
+
+    // finishes every capture in flight and stops the workers; needs the GL context
+    void Shutdown()
+    {
+        collect(true);
+        readback.Destroy();
+        stopWorkers();
+    }
+
+private:
+    struct Job {
+        std::string Path;
+        bool Droppable;
+        ReadbackImage Image;
+    };
+
+    PboReadback readback;
+    std::map<unsigned int, std::pair<std::string, bool>> requested;   // readback tag -> file name, droppable
+    unsigned int nextTag = 0;
+
+    bool screenshotRequested = false;
+    unsigned int sequenceLeft = 0;
+    unsigned int sequenceFrame = 0;
+    std::string sequenceName;
+
+    std::vector<std::thread> workers;
+    std::deque<Job> queue;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    bool request(int width, int height, const std::string &path, bool droppable)
+    {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        if (!readback.Request(0, 0, width, height, nextTag))
+            return false;
+        requested[nextTag++] = std::make_pair(path, droppable);
+        return true;
+    }
+
+    void collect(bool wait)
+    {
+        readback.Collect([this](ReadbackImage &image) {
+            auto it = requested.find(image.Tag);
+            if (it == requested.end())
+                return;
+            Job job{it->second.first, it->second.second, std::move(image)};
+            requested.erase(it);
+            enqueue(std::move(job));
+        }, wait);
+    }
+
+    void enqueue(Job job)
+    {
+        if (workers.empty())
+            for (unsigned int i = 0; i < CAPTURE_WORKERS; i++)
+                workers.emplace_back(&FrameCapture::work, this);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (job.Droppable && queue.size() >= CAPTURE_QUEUE_LIMIT) {
+                Dropped++;
+                return;
+            }
+            queue.push_back(std::move(job));
+        }
+        wake.notify_one();
+    }
+
+    void work()
+    {
+        while (true) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty())
+                    return;   // stopping, and everything queued was written
+                job = std::move(queue.front());
+                queue.pop_front();
+            }
+            // the default framebuffer's alpha is whatever blending left there, so it is not saved
+            std::vector<unsigned char> rgb = PngWriter::DropAlpha(job.Image.Pixels);
+            if (PngWriter::Write(job.Path, job.Image.Width, job.Image.Height, 3, rgb.data()))
+                Saved++;
+        }
+    }
+
+    void stopWorkers()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+        workers.clear();
+        stopping = false;
+    }
+
+    static std::string timestamp()
+    {
+        std::time_t now = std::time(nullptr);
+        char buffer[32];
+        std::strftime(buffer, sizeof(buffer), "%Y%m%d_%H%M%S", std::localtime(&now));
+        return buffer;
+    }
+};
+#endif
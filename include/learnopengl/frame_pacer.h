@@ -0,0 +1,150 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <GLFW/glfw3.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include <vector>
+
+// Defines the ways frame delivery can be paced. Used by the render loop and persisted in the program state
+enum Frame_Pacing {
+    PACING_UNCAPPED,
+    PACING_VSYNC,
+    PACING_ADAPTIVE_VSYNC,
+    PACING_CAPPED
+};
+
+const char *const FRAME_PACING_NAMES[] = {"Uncapped", "VSync", "Adaptive VSync", "Capped FPS"};
+
+// Default pacing values
+const double TARGET_FPS            = 60.0;
+const double MAX_FRAME_TIME        = 0.25;  // longer frames are clamped so the simulation never spirals after a hitch
+const unsigned int HISTORY_SIZE    = 240;   // frame times kept for the plot
+const unsigned int HISTOGRAM_BINS  = 50;    // 1 ms per bin
+const double SPIN_THRESHOLD        = 0.002; // the last part of the wait is spun instead of slept
+
+
+// Measures frame times, applies the selected swap interval and, in capped mode, limits the frame rate with
+// a coarse sleep followed by a short spin so frames are delivered on a steady cadence.
+class FramePacer
+{
+public:
+    Frame_Pacing Mode;
+    double TargetFps;
+
+    // frame statistics
+    std::vector<float> History;        // frame times in milliseconds, oldest first
+    std::vector<float> Histogram;      // frame count per 1 ms bin
+    float AverageMs;
+    float JitterMs;                    // standard deviation of the frame times in History
+
+    FramePacer(Frame_Pacing mode = PACING_VSYNC, double targetFps = TARGET_FPS)
+        : Mode(mode), TargetFps(targetFps), History(HISTORY_SIZE, 0.0f), Histogram(HISTOGRAM_BINS, 0.0f),
+          AverageMs(0.0f), JitterMs(0.0f), appliedMode(-1), lastFrame(-1.0), deadline(0.0), spinThreshold(SPIN_THRESHOLD)
+    {
+    }
+
+    // sets the swap interval for the current mode; cheap to call every frame, only talks to the driver on change
+    void Apply()
+    {
+        if (appliedMode == (int)Mode)
+            return;
+        appliedMode = (int)Mode;
+
+        if (Mode == PACING_VSYNC)
+            glfwSwapInterval(1);
+        else if (Mode == PACING_ADAPTIVE_VSYNC)
+            glfwSwapInterval(AdaptiveVSyncSupported() ? -1 : 1);
+        else
+            glfwSwapInterval(0);
+        deadline = 0.0;
+    }
+
+    // late frames tear instead of waiting a whole extra refresh when the driver supports it
+    static bool AdaptiveVSyncSupported()
+    {
+        return glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+    }
+
+    // returns the time elapsed since the previous call (clamped) and records it in the statistics
+    double BeginFrame()
+    {
+        double now = glfwGetTime();
+        if (lastFrame < 0.0) {
+            lastFrame = now;
+            return 0.0;
+        }
+        double frameTime = now - lastFrame;
+        lastFrame = now;
+
+        record((float)(frameTime * 1000.0));
+        return std::min(frameTime, MAX_FRAME_TIME);
+    }
+
+    // blocks until the next frame is due; only does anything in capped mode
+    void Wait()
+    {
+        if (Mode != PACING_CAPPED || TargetFps <= 0.0)
+            return;
+
+        double period = 1.0 / TargetFps;
+        double now = glfwGetTime();
+        // schedule against the previous deadline so rounding errors do not accumulate, but resynchronize after a hitch
+        if (deadline == 0.0 || now - deadline > period)
+            deadline = now;
+        deadline += period;
+
+        double remaining = deadline - now;
+        if (remaining > spinThreshold) {
+            double beforeSleep = glfwGetTime();
+            double requested = remaining - spinThreshold;
+            std::this_thread::sleep_for(std::chrono::duration<double>(requested));
+            // track how much the OS oversleeps and keep the spin window just large enough to absorb it
+            double overshoot = (glfwGetTime() - beforeSleep) - requested;
+            spinThreshold = std::max(SPIN_THRESHOLD, 0.9 * spinThreshold + 0.1 * (overshoot + 0.0005));
+        }
+        while (glfwGetTime() < deadline)
+            std::this_thread::yield();
+    }
+
+    // called after the loop stopped rendering for a while, so the pause is not measured as one long frame
+    void Resume()
+    {
+        lastFrame = -1.0;
+        deadline = 0.0;
+    }
+
+    void ResetStatistics()
+    {
+        std::fill(History.begin(), History.end(), 0.0f);
+        std::fill(Histogram.begin(), Histogram.end(), 0.0f);
+        AverageMs = JitterMs = 0.0f;
+    }
+
+private:
+    int appliedMode;
+    double lastFrame;
+    double deadline;
+    double spinThreshold;
+
+    void record(float ms)
+    {
+        History.erase(History.begin());
+        History.push_back(ms);
+
+        unsigned int bin = std::min((unsigned int)ms, HISTOGRAM_BINS - 1);
+        Histogram[bin] += 1.0f;
+
+        float sum = 0.0f, sumSquares = 0.0f;
+        for (float t : History) {
+            sum += t;
+            sumSquares += t * t;
+        }
+        AverageMs = sum / History.size();
+        JitterMs = std::sqrt(std::max(0.0f, sumSquares / History.size() - AverageMs * AverageMs));
+    }
+};
+#endif
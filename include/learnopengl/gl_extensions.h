@@ -0,0 +1,19 @@
+#ifndef GL_EXTENSIONS_H
+#define GL_EXTENSIONS_H
+
+#include <glad/glad.h>
+
+#include <cstring>
+
+// true if the current context lists the extension; the 3.3 core glad loader only knows core functions, so the
+// optional features (program binaries, parallel compilation, ...) check here and load their own entry points
+inline bool HasGLExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+        if (std::strcmp((const char *) glGetStringi(GL_EXTENSIONS, i), name) == 0)
+            return true;
+    return false;
+}
+#endif
@@ -0,0 +1,662 @@
+#ifndef GLTF_LOADER_H
+#define GLTF_LOADER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+#include <learnopengl/resource_registry.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+// Default glTF loader values
+const uint32_t GLTF_BINARY_MAGIC = 0x46546C67;   // "glTF", the header of .glb files
+const uint32_t GLTF_CHUNK_JSON   = 0x4E4F534A;
+const uint32_t GLTF_CHUNK_BIN    = 0x004E4942;
+
+
+// A parsed JSON document; enough of JSON for glTF, numbers are kept as doubles.
+struct JsonValue {
+    enum Json_Type { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_ARRAY, JSON_OBJECT };
+
+    Json_Type Type = JSON_NULL;
+    double Number = 0.0;   // also 0 / 1 for booleans
+    std::string String;
+    std::vector<JsonValue> Array;
+    std::map<std::string, JsonValue> Object;
+
+    // false on a syntax error
+    static bool Parse(const char *text, size_t length, JsonValue &value)
+    {
+        const char *end = text + length;
+        return parse(text, end, value) && (skip(text, end), text == end);
+    }
+
+    bool Has(const std::string &key) const
+    {
+        return Type == JSON_OBJECT && Object.count(key) > 0;
+    }
+    // the member, or a null value when there is none
+    const JsonValue &operator[](const std::string &key) const
+    {
+        static const JsonValue none;
+        auto found = Type == JSON_OBJECT ? Object.find(key) : Object.end();
+        return found != Object.end() ? found->second : none;
+    }
+    const JsonValue &operator[](size_t index) const
+    {
+        static const JsonValue none;
+        return Type == JSON_ARRAY && index < Array.size() ? Array[index] : none;
+    }
+    size_t Size() const
+    {
+        return Type == JSON_ARRAY ? Array.size() : 0;
+    }
+    double AsNumber(double fallback = 0.0) const
+    {
+        return Type == JSON_NUMBER || Type == JSON_BOOL ? Number : fallback;
+    }
+    int AsInt(int fallback = -1) const
+    {
+        return Type == JSON_NUMBER ? (int) Number : fallback;
+    }
+    const std::string &AsString() const
+    {
+        return String;
+    }
+
+private:
+    static void skip(const char *&text, const char *end)
+    {
+        while (text < end && (*text == ' ' || *text == '\t' || *text == '\n' || *text == '\r'))
+            text++;
+    }
+
+    static bool literal(const char *&text, const char *end, const char *word)
+    {
+        size_t length = std::strlen(word);
+        if ((size_t) (end - text) < length || std::strncmp(text, word, length) != 0)
+            return false;
+        text += length;
+        return true;
+    }
+
+    static bool parseString(const char *&text, const char *end, std::string &out)
+    {
+        text++;   // the opening quote
+        while (text < end && *text != '"') {
+            if (*text != '\\') {
+                out += *text++;
+                continue;
+            }
+            if (++text == end)
+                return false;
+            char escaped = *text++;
+            switch (escaped) {
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                if (end - text < 4)
+                    return false;
+                unsigned int code = (unsigned int) std::strtoul(std::string(text, 4).c_str(), nullptr, 16);
+                text += 4;
+                // names and paths are what glTF strings hold; anything outside ASCII is kept as UTF-8
+                if (code < 0x80)
+                    out += (char) code;
+                else if (code < 0x800) {
+                    out += (char) (0xC0 | (code >> 6));
+                    out += (char) (0x80 | (code & 0x3F));
+                } else {
+                    out += (char) (0xE0 | (code >> 12));
+                    out += (char) (0x80 | ((code >> 6) & 0x3F));
+                    out += (char) (0x80 | (code & 0x3F));
+                }
+                break;
+            }
+            default: out += escaped; break;   // \" \\ \/
+            }
+        }
+        if (text == end)
+            return false;
+        text++;
+        return true;
+    }
+
+    static bool parse(const char *&text, const char *end, JsonValue &value)
+    {
+        skip(text, end);
+        if (text == end)
+            return false;
+        switch (*text) {
+        case '{':
+            value.Type = JSON_OBJECT;
+            text++;
+            skip(text, end);
+            if (text < end && *text == '}')
+                return text++, true;
+            while (true) {
+                skip(text, end);
+                std::string key;
+                if (text == end || *text != '"' || !parseString(text, end, key))
+                    return false;
+                skip(text, end);
+                if (text == end || *text++ != ':' || !parse(text, end, value.Object[key]))
+                    return false;
+                skip(text, end);
+                if (text < end && *text == ',') {
+                    text++;
+                    continue;
+                }
+                return text < end && *text++ == '}';
+            }
+        case '[':
+            value.Type = JSON_ARRAY;
+            text++;
+            skip(text, end);
+            if (text < end && *text == ']')
+                return text++, true;
+            while (true) {
+                value.Array.emplace_back();
+                if (!parse(text, end, value.Array.back()))
+                    return false;
+                skip(text, end);
+                if (text < end && *text == ',') {
+                    text++;
+                    continue;
+                }
+                return text < end && *text++ == ']';
+            }
+        case '"':
+            value.Type = JSON_STRING;
+            return parseString(text, end, value.String);
+        case 't':
+            value.Type = JSON_BOOL;
+            value.Number = 1.0;
+            return literal(text, end, "true");
+        case 'f':
+            value.Type = JSON_BOOL;
+            return literal(text, end, "false");
+        case 'n':
+            return literal(text, end, "null");
+        default: {
+            // strtod needs a terminated string, numbers are short
+            const char *start = text;
+            while (text < end && *text && (std::strchr("+-.eE", *text) || (*text >= '0' && *text <= '9')))
+                text++;
+            if (text == start)
+                return false;
+            value.Type = JSON_NUMBER;
+            value.Number = std::strtod(std::string(start, text).c_str(), nullptr);
+            return true;
+        }
+        }
+    }
+};
+
+
+// A read-only memory mapping of a whole file; the pages are only read when touched.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    ~MappedFile()
+    {
+        if (data)
+            munmap(data, size);
+    }
+
+    bool Open(const std::string &path)
+    {
+        int file = open(path.c_str(), O_RDONLY);
+        if (file < 0)
+            return false;
+        struct stat info;
+        if (fstat(file, &info) == 0 && info.st_size > 0) {
+            void *mapped = mmap(nullptr, (size_t) info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+            if (mapped != MAP_FAILED) {
+                data = mapped;
+                size = (size_t) info.st_size;
+            }
+        }
+        close(file);
+        return data != nullptr;
+    }
+
+    const unsigned char *Data() const
+    {
+        return (const unsigned char *) data;
+    }
+    size_t Size() const
+    {
+        return size;
+    }
+
+private:
+    void *data = nullptr;
+    size_t size = 0;
+};
+
+
+// Loads the meshes of a glTF 2.0 file (.gltf with external buffers, or .glb) without Assimp. Parse reads the JSON
+// and memory maps the buffers; it makes no GL calls, so it runs on any thread. Upload then creates one GL buffer
+// per buffer view the meshes use and copies the view from the mapping straight into the buffer mapped with
+// glMapBufferRange, so the geometry never passes through an intermediate array. The MeshLayouts point at the
+// views with the formats, offsets and strides of their accessors.
+//
+// Node transforms are not applied, as with the Assimp import. Files this loader does not handle (embedded data:
+// URIs, sparse accessors, non-indexed or non-triangle primitives) make Parse fail, and the Model falls back to
+// Assimp for them as for every other format.
+class GltfLoader
+{
+public:
+    struct Material {
+        std::string BaseColor;   // image path relative to the file's directory, empty without a texture
+        Material_Alpha Alpha = ALPHA_MASKED;
+    };
+    struct Primitive {
+        MeshLayout Layout;
+        int Material = -1;
+    };
+
+    std::vector<Primitive> Primitives;   // in node order, a mesh used by several nodes appears for each
+    std::vector<Material> Materials;
+
+    // true if the file is glTF and every primitive can be loaded
+    bool Parse(const std::string &path)
+    {
+        std::string extension = path.substr(path.find_last_of('.') + 1);
+        if (extension != "gltf" && extension != "glb")
+            return false;
+        std::string directory = path.substr(0, path.find_last_of('/') + 1);
+
+        const char *json = nullptr;
+        size_t jsonLength = 0;
+        std::string text;
+        if (extension == "glb") {
+            files.emplace_back(new MappedFile());
+            if (!files.back()->Open(path) || !readBinary(*files.back(), json, jsonLength))
+                return false;
+        } else {
+            std::ifstream in(path, std::ios::binary);
+            if (!in)
+                return false;
+            std::stringstream stream;
+            stream << in.rdbuf();
+            text = stream.str();
+            json = text.data();
+            jsonLength = text.size();
+        }
+        if (!JsonValue::Parse(json, jsonLength, document)) {
+            std::cout << "ERROR::GLTF:: Failed to parse " << path << ", using Assimp" << std::endl;
+            return false;
+        }
+        return readBuffers(directory) && readMaterials() && readNodes();
+    }
+
+    // creates the GL buffers and fills in the layouts' buffer names; owner names them in the ResourceRegistry
+    void Upload(const std::string &owner)
+    {
+        glBindVertexArray(0);
+        for (View &view : views) {
+            if (!view.Used)
+                continue;
+            glGenBuffers(1, &view.Buffer);
+            // a buffer can be bound to any target later; the copy target leaves the vertex array state alone
+            glBindBuffer(GL_COPY_WRITE_BUFFER, view.Buffer);
+            glBufferData(GL_COPY_WRITE_BUFFER, view.Length, nullptr, GL_STATIC_DRAW);
+            void *target = glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, view.Length,
+                                            GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+            if (!target || (std::memcpy(target, view.Data, view.Length), glUnmapBuffer(GL_COPY_WRITE_BUFFER) != GL_TRUE))
+                glBufferSubData(GL_COPY_WRITE_BUFFER, 0, view.Length, view.Data);   // mapping failed or was lost
+            ResourceRegistry::Get().Track(RESOURCE_BUFFER, view.Buffer, view.Length,
+                                          owner + " buffer view " + std::to_string(&view - views.data()));
+        }
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+        for (Primitive &primitive : Primitives) {
+            for (MeshLayout::Attribute &attribute : primitive.Layout.Attributes)
+                if (attribute.Buffer != 0)
+                    attribute.Buffer = views[attribute.Buffer - 1].Buffer;
+            primitive.Layout.IndexBuffer = views[primitive.Layout.IndexBuffer - 1].Buffer;
+        }
+    }
+
+private:
+    // a buffer view, in the memory of the mapped file
+    struct View {
+        const unsigned char *Data = nullptr;
+        size_t Length = 0;
+        size_t Stride = 0;
+        bool Used = false;
+        unsigned int Buffer = 0;
+    };
+    // where an accessor's elements are, for the few that are read on the CPU
+    struct Elements {
+        const unsigned char *Data = nullptr;
+        size_t Stride = 0;
+        GLenum Type = GL_FLOAT;
+        int Size = 0;
+        bool Normalized = false;
+        size_t Count = 0;
+    };
+
+    JsonValue document;
+    std::vector<std::unique_ptr<MappedFile>> files;
+    std::vector<View> views;
+    const unsigned char *binaryChunk = nullptr;
+    size_t binaryChunkLength = 0;
+
+    bool readBinary(const MappedFile &file, const char *&json, size_t &jsonLength)
+    {
+        const unsigned char *data = file.Data();
+        size_t size = file.Size();
+        if (size < 20 || read32(data) != GLTF_BINARY_MAGIC || read32(data + 4) != 2)
+            return false;
+        size_t offset = 12;
+        while (offset + 8 <= size) {
+            size_t length = read32(data + offset);
+            uint32_t type = read32(data + offset + 4);
+            if (offset + 8 + length > size)
+                return false;
+            if (type == GLTF_CHUNK_JSON) {
+                json = (const char *) data + offset + 8;
+                jsonLength = length;
+            } else if (type == GLTF_CHUNK_BIN && !binaryChunk) {
+                binaryChunk = data + offset + 8;
+                binaryChunkLength = length;
+            }
+            offset += 8 + ((length + 3) & ~(size_t) 3);
+        }
+        return json != nullptr;
+    }
+
+    static uint32_t read32(const unsigned char *data)
+    {
+        uint32_t value;
+        std::memcpy(&value, data, sizeof(value));   // glTF is little endian, as every platform we build for
+        return value;
+    }
+
+    bool readBuffers(const std::string &directory)
+    {
+        std::vector<std::pair<const unsigned char *, size_t>> buffers;
+        const JsonValue &list = document["buffers"];
+        for (size_t i = 0; i < list.Size(); i++) {
+            const JsonValue &buffer = list[i];
+            size_t length = (size_t) buffer["byteLength"].AsNumber();
+            if (!buffer.Has("uri")) {   // the binary chunk of a .glb
+                if (!binaryChunk || binaryChunkLength < length)
+                    return false;
+                buffers.emplace_back(binaryChunk, length);
+                continue;
+            }
+            const std::string &uri = buffer["uri"].AsString();
+            if (uri.compare(0, 5, "data:") == 0)
+                return false;
+            files.emplace_back(new MappedFile());
+            if (!files.back()->Open(directory + uri) || files.back()->Size() < length) {
+                std::cout << "ERROR::GLTF:: Failed to map buffer " << directory + uri << ", using Assimp" << std::endl;
+                return false;
+            }
+            buffers.emplace_back(files.back()->Data(), length);
+        }
+
+        const JsonValue &viewList = document["bufferViews"];
+        for (size_t i = 0; i < viewList.Size(); i++) {
+            const JsonValue &json = viewList[i];
+            int buffer = json["buffer"].AsInt();
+            View view;
+            size_t offset = (size_t) json["byteOffset"].AsNumber();
+            view.Length = (size_t) json["byteLength"].AsNumber();
+            view.Stride = (size_t) json["byteStride"].AsNumber();
+            if (buffer < 0 || buffer >= (int) buffers.size() || offset + view.Length > buffers[buffer].second)
+                return false;
+            view.Data = buffers[buffer].first + offset;
+            views.push_back(view);
+        }
+        return true;
+    }
+
+    bool readMaterials()
+    {
+        const JsonValue &list = document["materials"];
+        for (size_t i = 0; i < list.Size(); i++) {
+            const JsonValue &json = list[i];
+            Material material;
+            // the default of glTF, what Assimp reports for materials without an alphaMode as well
+            material.Alpha = ALPHA_OPAQUE;
+            const std::string &mode = json["alphaMode"].AsString();
+            if (mode == "MASK")
+                material.Alpha = ALPHA_MASKED;
+            else if (mode == "BLEND")
+                material.Alpha = ALPHA_BLENDED;
+            int texture = json["pbrMetallicRoughness"]["baseColorTexture"]["index"].AsInt();
+            int image = document["textures"][(size_t) std::max(texture, 0)]["source"].AsInt();
+            if (texture >= 0 && image >= 0) {
+                material.BaseColor = decodeUri(document["images"][(size_t) image]["uri"].AsString());
+                if (material.BaseColor.empty() || material.BaseColor.compare(0, 5, "data:") == 0)
+                    return false;   // images in buffers are left to Assimp
+            }
+            Materials.push_back(material);
+        }
+        return true;
+    }
+
+    // URIs may escape characters such as spaces as %XX
+    static std::string decodeUri(const std::string &uri)
+    {
+        std::string path;
+        for (size_t i = 0; i < uri.size(); i++) {
+            if (uri[i] == '%' && i + 2 < uri.size()) {
+                path += (char) std::strtol(uri.substr(i + 1, 2).c_str(), nullptr, 16);
+                i += 2;
+            } else
+                path += uri[i];
+        }
+        return path;
+    }
+
+    // walks the default scene's nodes depth first, the order Assimp lists the meshes in
+    bool readNodes()
+    {
+        const JsonValue &scenes = document["scenes"];
+        const JsonValue &scene = scenes[(size_t) std::max(document["scene"].AsInt(0), 0)];
+        const JsonValue &roots = scene["nodes"];
+        for (size_t i = 0; i < roots.Size(); i++)
+            if (!readNode(roots[i].AsInt(), 0))
+                return false;
+        return !Primitives.empty();
+    }
+
+    bool readNode(int index, int depth)
+    {
+        const JsonValue &node = document["nodes"][(size_t) std::max(index, 0)];
+        if (index < 0 || node.Type != JsonValue::JSON_OBJECT || depth > 64)
+            return false;
+        if (node.Has("mesh")) {
+            const JsonValue &primitives = document["meshes"][(size_t) std::max(node["mesh"].AsInt(), 0)]["primitives"];
+            for (size_t i = 0; i < primitives.Size(); i++) {
+                Primitive primitive;
+                if (!readPrimitive(primitives[i], primitive))
+                    return false;
+                Primitives.push_back(primitive);
+            }
+        }
+        const JsonValue &children = node["children"];
+        for (size_t i = 0; i < children.Size(); i++)
+            if (!readNode(children[i].AsInt(), depth + 1))
+                return false;
+        return true;
+    }
+
+    bool readPrimitive(const JsonValue &json, Primitive &primitive)
+    {
+        if (json["mode"].AsInt(4) != 4 || !json.Has("indices"))
+            return false;
+        const JsonValue &attributes = json["attributes"];
+        const char *const names[] = {"POSITION", "NORMAL", "TEXCOORD_0", "TANGENT"};   // bitangents are not stored
+        MeshLayout &layout = primitive.Layout;
+        Elements positions, uvs, indices;
+        for (int location = 0; location < 4; location++) {
+            if (!attributes.Has(names[location]))
+                continue;
+            Elements elements;
+            if (!accessor(attributes[names[location]].AsInt(), layout.Attributes[location], elements))
+                return false;
+            if (location == 0)
+                positions = elements;
+            if (location == 2)
+                uvs = elements;
+        }
+        if (layout.Attributes[0].Buffer == 0 || positions.Type != GL_FLOAT || positions.Size != 3)
+            return false;
+
+        MeshLayout::Attribute indexAttribute;
+        if (!accessor(json["indices"].AsInt(), indexAttribute, indices) || indices.Size != 1 ||
+            (indices.Type != GL_UNSIGNED_BYTE && indices.Type != GL_UNSIGNED_SHORT && indices.Type != GL_UNSIGNED_INT))
+            return false;
+        layout.IndexBuffer = indexAttribute.Buffer;
+        layout.IndexType = indices.Type;
+        layout.IndexOffset = indexAttribute.Offset;
+        layout.IndexCount = (unsigned int) indices.Count;
+        primitive.Material = json["material"].AsInt();
+
+        bounds(attributes["POSITION"].AsInt(), positions, layout);
+        layout.UVDensity = uvDensity(positions, uvs, indices);
+        return true;
+    }
+
+    // fills the attribute from an accessor; Buffer is the view's index + 1 until Upload creates the buffers
+    bool accessor(int index, MeshLayout::Attribute &attribute, Elements &elements)
+    {
+        const JsonValue &json = document["accessors"][(size_t) std::max(index, 0)];
+        int viewIndex = json["bufferView"].AsInt();
+        if (index < 0 || json.Has("sparse") || viewIndex < 0 || viewIndex >= (int) views.size())
+            return false;
+        static const std::map<std::string, int> sizes = {{"SCALAR", 1}, {"VEC2", 2}, {"VEC3", 3}, {"VEC4", 4}};
+        auto size = sizes.find(json["type"].AsString());
+        if (size == sizes.end())
+            return false;
+        View &view = views[viewIndex];
+        elements.Type = (GLenum) json["componentType"].AsInt();
+        elements.Size = size->second;
+        elements.Normalized = json["normalized"].AsNumber() != 0.0;
+        elements.Count = (size_t) json["count"].AsNumber();
+        size_t componentBytes = elements.Type == GL_FLOAT || elements.Type == GL_UNSIGNED_INT ? 4
+                              : elements.Type == GL_UNSIGNED_SHORT || elements.Type == GL_SHORT ? 2 : 1;
+        size_t offset = (size_t) json["byteOffset"].AsNumber();
+        elements.Stride = view.Stride ? view.Stride : componentBytes * elements.Size;
+        if (elements.Count == 0 || offset + (elements.Count - 1) * elements.Stride + componentBytes * elements.Size > view.Length)
+            return false;
+        elements.Data = view.Data + offset;
+        view.Used = true;
+
+        attribute.Buffer = (unsigned int) viewIndex + 1;
+        attribute.Size = elements.Size;
+        attribute.Type = elements.Type;
+        attribute.Normalized = elements.Normalized ? GL_TRUE : GL_FALSE;
+        attribute.Stride = (GLsizei) view.Stride;
+        attribute.Offset = offset;
+        return true;
+    }
+
+    // glTF requires min and max on positions; they are computed from the data for files that leave them out
+    void bounds(int index, const Elements &positions, MeshLayout &layout) const
+    {
+        const JsonValue &json = document["accessors"][(size_t) index];
+        if (json["min"].Size() == 3 && json["max"].Size() == 3) {
+            for (int k = 0; k < 3; k++) {
+                layout.Low[k] = (float) json["min"][k].AsNumber();
+                layout.High[k] = (float) json["max"][k].AsNumber();
+            }
+            return;
+        }
+        layout.Low = layout.High = position(positions, 0);
+        for (size_t i = 1; i < positions.Count; i++) {
+            layout.Low = glm::min(layout.Low, position(positions, i));
+            layout.High = glm::max(layout.High, position(positions, i));
+        }
+    }
+
+    static glm::vec3 position(const Elements &positions, size_t i)
+    {
+        glm::vec3 value;
+        std::memcpy(&value, positions.Data + i * positions.Stride, sizeof(value));
+        return value;
+    }
+
+    static glm::vec2 texCoord(const Elements &uvs, size_t i)
+    {
+        const unsigned char *data = uvs.Data + i * uvs.Stride;
+        float value[2];
+        for (int k = 0; k < 2; k++) {
+            if (uvs.Type == GL_FLOAT)
+                std::memcpy(&value[k], data + k * 4, 4);
+            else if (uvs.Type == GL_UNSIGNED_SHORT) {
+                uint16_t v;
+                std::memcpy(&v, data + k * 2, 2);
+                value[k] = v / 65535.0f;
+            } else
+                value[k] = data[k] / 255.0f;
+        }
+        return glm::vec2(value[0], value[1]);
+    }
+
+    static unsigned int vertexIndex(const Elements &indices, size_t i)
+    {
+        const unsigned char *data = indices.Data + i * indices.Stride;
+        if (indices.Type == GL_UNSIGNED_INT) {
+            uint32_t v;
+            std::memcpy(&v, data, 4);
+            return v;
+        }
+        if (indices.Type == GL_UNSIGNED_SHORT) {
+            uint16_t v;
+            std::memcpy(&v, data, 2);
+            return v;
+        }
+        return data[0];
+    }
+
+    // the ratio of the triangles' areas in texture and in model space, as Mesh computes it for its vertices
+    static float uvDensity(const Elements &positions, const Elements &uvs, const Elements &indices)
+    {
+        if (!uvs.Data || uvs.Size != 2)
+            return 0.0f;
+        double uvArea = 0.0, area = 0.0;
+        for (size_t i = 0; i + 2 < indices.Count; i += 3) {
+            unsigned int a = vertexIndex(indices, i), b = vertexIndex(indices, i + 1), c = vertexIndex(indices, i + 2);
+            if (std::max(a, std::max(b, c)) >= std::min(positions.Count, uvs.Count))
+                continue;
+            glm::vec2 uv0 = texCoord(uvs, b) - texCoord(uvs, a), uv1 = texCoord(uvs, c) - texCoord(uvs, a);
+            uvArea += std::abs(uv0.x * uv1.y - uv0.y * uv1.x) * 0.5;
+            glm::vec3 pa = position(positions, a);
+            area += glm::length(glm::cross(position(positions, b) - pa, position(positions, c) - pa)) * 0.5;
+        }
+        return area > 0.0 ? (float) std::sqrt(uvArea / area) : 0.0f;
+    }
+};
+#endif
@@ -0,0 +1,170 @@
+#ifndef GOLDEN_IMAGE_H
+#define GOLDEN_IMAGE_H
+
+#include <stb_image.h>
+
+#include <learnopengl/benchmark.h>
+#include <learnopengl/camera.h>
+#include <learnopengl/pbo_readback.h>
+#include <learnopengl/png_writer.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Default golden image values
+const unsigned int GOLDEN_SETTLE_FRAMES = 3;     // frames rendered per view before it is read back
+const float GOLDEN_THRESHOLD            = 0.1f;  // perceptual difference (0..1) above which a pixel counts as changed
+const float GOLDEN_MAX_CHANGED          = 0.001f; // fraction of changed pixels a view may have and still pass
+const float YIQ_MAX_DELTA               = 35215.0f; // largest possible yiqDelta, between black and white
+
+
+// Renders canonical viewpoints of the scene and compares them against reference images stored as
+// <directory>/view_<n>.png. Pixels are compared in YIQ space, weighted the way the eye weighs brightness against
+// hue, so that rounding differences between drivers pass while a missing light or a wrong texture does not.
+// A failing view writes view_<n>.actual.png and view_<n>.diff.png (changed pixels in red) next to the reference.
+class GoldenTest
+{
+public:
+    bool Enabled = false;
+    bool Update = false;        // --golden-update: store the rendered views as the new references
+    std::string Directory;
+    float Threshold = GOLDEN_THRESHOLD;
+    int Width = 640;
+    int Height = 360;
+    std::vector<CameraKey> Views;
+
+    unsigned int Checked = 0;
+    unsigned int Failed = 0;
+
+    GoldenTest()
+    {
+        Views = {
+                {glm::vec3(0.0f, 0.5f, 6.0f), -90.0f, -5.0f},     // overview from the front
+                {glm::vec3(-6.0f, 1.5f, -2.0f), -40.0f, -10.0f},  // bridge and river
+                {glm::vec3(-1.0f, 0.5f, -4.0f), -120.0f, -5.0f},  // cottage close up, alpha-tested foliage
+                {glm::vec3(5.0f, 2.0f, -1.0f), -160.0f, -15.0f},  // looking back over the river
+                {glm::vec3(0.0f, 0.0f, 0.0f), -90.0f, 60.0f}      // mostly skybox
+        };
+    }
+
+    // --golden <directory> [--golden-update] [--golden-threshold 0.1] [--size WxH]
+    void ParseArguments(int argc, char **argv)
+    {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--golden" && hasValue) {
+                Enabled = true;
+                Directory = argv[++i];
+            } else if (arg == "--golden-update")
+                Update = true;
+            else if (arg == "--golden-threshold" && hasValue)
+                Threshold = (float) std::atof(argv[++i]);
+            else if (arg == "--size" && hasValue)
+                std::sscanf(argv[++i], "%dx%d", &Width, &Height);
+        }
+    }
+
+    // view to show during the given frame of the run; returns false once every view was rendered
+    bool ApplyView(Camera &camera, unsigned int frame) const
+    {
+        unsigned int view = frame / GOLDEN_SETTLE_FRAMES;
+        if (view >= Views.size())
+            return false;
+        camera.Position = Views[view].Position;
+        camera.PreviousPosition = camera.Position;
+        camera.Zoom = ZOOM;
+        camera.SetOrientation(Views[view].Yaw, Views[view].Pitch);
+        return true;
+    }
+
+    // true in the frame whose image should be read back for its view
+    bool CaptureFrame(unsigned int frame) const
+    {
+        return frame % GOLDEN_SETTLE_FRAMES == GOLDEN_SETTLE_FRAMES - 1;
+    }
+
+    // stores or compares a view read back by PboReadback; the tag is the view index
+    void Check(const ReadbackImage &image)
+    {
+        std::string base = Directory + "/view_" + std::to_string(image.Tag);
+        std::vector<unsigned char> actual = PngWriter::DropAlpha(image.Pixels);
+        Checked++;
+        if (Update) {
+            if (PngWriter::Write(base + ".png", image.Width, image.Height, 3, actual.data()))
+                std::cout << "GOLDEN:: " << base << ".png updated" << std::endl;
+            else
+                Failed++;
+            return;
+        }
+
+        int width, height, channels;
+        unsigned char *reference = stbi_load((base + ".png").c_str(), &width, &height, &channels, 3);
+        if (!reference) {
+            std::cout << "GOLDEN:: " << base << ".png missing, run with --golden-update to create it" << std::endl;
+            Failed++;
+            return;
+        }
+        if (width != image.Width || height != image.Height) {
+            std::cout << "GOLDEN:: " << base << ".png is " << width << "x" << height << ", rendered "
+                      << image.Width << "x" << image.Height << std::endl;
+            stbi_image_free(reference);
+            Failed++;
+            return;
+        }
+
+        size_t pixels = (size_t) width * height;
+        float maxDelta = YIQ_MAX_DELTA * Threshold * Threshold;
+        std::vector<unsigned char> diff(pixels * 3);
+        size_t changed = 0;
+        for (size_t i = 0; i < pixels; i++) {
+            const unsigned char *a = &actual[i * 3];
+            const unsigned char *b = &reference[i * 3];
+            if (yiqDelta(a, b) > maxDelta) {
+                changed++;
+                diff[i * 3] = 255;
+                diff[i * 3 + 1] = diff[i * 3 + 2] = 0;
+            } else {
+                // unchanged pixels as faded grayscale, so the changes stand out but can still be located
+                unsigned char gray = (unsigned char) (191 + brightness(b) / 4.0f);
+                diff[i * 3] = diff[i * 3 + 1] = diff[i * 3 + 2] = gray;
+            }
+        }
+        stbi_image_free(reference);
+
+        float fraction = (float) changed / (float) pixels;
+        bool passed = fraction <= GOLDEN_MAX_CHANGED;
+        std::cout << "GOLDEN:: view " << image.Tag << ": " << changed << " pixels changed (" << fraction * 100.0f
+                  << " %) " << (passed ? "ok" : "FAILED") << std::endl;
+        if (!passed) {
+            Failed++;
+            PngWriter::Write(base + ".actual.png", width, height, 3, actual.data());
+            PngWriter::Write(base + ".diff.png", width, height, 3, diff.data());
+        }
+    }
+
+    bool Passed() const
+    {
+        return Failed == 0 && Checked == Views.size();
+    }
+
+private:
+    static float brightness(const unsigned char *rgb)
+    {
+        return rgb[0] * 0.29889531f + rgb[1] * 0.58662247f + rgb[2] * 0.11448223f;
+    }
+
+    // squared perceptual distance of two colors in YIQ space, 0 .. YIQ_MAX_DELTA
+    static float yiqDelta(const unsigned char *a, const unsigned char *b)
+    {
+        float r = (float) a[0] - b[0], g = (float) a[1] - b[1], bl = (float) a[2] - b[2];
+        float y = r * 0.29889531f + g * 0.58662247f + bl * 0.11448223f;
+        float i = r * 0.59597799f - g * 0.27417610f - bl * 0.32180189f;
+        float q = r * 0.21147017f - g * 0.52261711f + bl * 0.31114694f;
+        return 0.5053f * y * y + 0.299f * i * i + 0.1957f * q * q;
+    }
+};
+#endif
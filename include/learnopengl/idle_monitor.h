@@ -0,0 +1,53 @@
+#ifndef IDLE_MONITOR_H
+#define IDLE_MONITOR_H
+
+#include <cstring>
+#include <vector>
+
+// Default idle values
+const int REDRAW_FRAMES            = 3;    // frames rendered after an event, lets ImGui and interpolation settle
+const double IDLE_WAIT_TIMEOUT     = 0.5;  // upper bound for blocking on events while idle
+
+
+// Decides whether the next frame needs to be rendered at all. Input callbacks request redraws, and the render
+// loop reports a snapshot of everything that affects the image; when neither changes the last presented frame
+// is still valid and the loop can block on events instead of rendering identical frames.
+class IdleMonitor
+{
+public:
+    bool Idle;  // true while the loop is not rendering
+
+    IdleMonitor() : Idle(false), pendingFrames(REDRAW_FRAMES) {}
+
+    // called from event callbacks; wakes the loop for the next few frames
+    void RequestRedraw(int frames = REDRAW_FRAMES)
+    {
+        if (pendingFrames < frames)
+            pendingFrames = frames;
+    }
+
+    // compares the state the image depends on against the one from the previous frame
+    void Observe(const void *state, size_t size)
+    {
+        const unsigned char *bytes = (const unsigned char *) state;
+        if (lastState.size() != size || std::memcmp(lastState.data(), bytes, size) != 0) {
+            lastState.assign(bytes, bytes + size);
+            RequestRedraw();
+        }
+    }
+
+    // consumes one pending frame; returns false when the scene is static
+    bool ShouldRender()
+    {
+        Idle = pendingFrames <= 0;
+        if (Idle)
+            return false;
+        pendingFrames--;
+        return true;
+    }
+
+private:
+    int pendingFrames;
+    std::vector<unsigned char> lastState;
+};
+#endif
@@ -0,0 +1,476 @@
+#ifndef IMAGE_BASED_LIGHTING_H
+#define IMAGE_BASED_LIGHTING_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <stb_image.h>
+
+#include <learnopengl/content_hash.h>
+#include <learnopengl/resource_registry.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Default image based lighting values
+const int IBL_SOURCE_SIZE             = 128;   // the faces are box filtered to this size before baking
+const int IBL_PREFILTER_SIZE          = 64;    // face size of the roughness 0 level
+const int IBL_PREFILTER_MIPS          = 5;     // roughness 0, 0.25, ..., 1
+const unsigned int IBL_PREFILTER_SAMPLES = 64;
+const int IBL_BRDF_LUT_SIZE           = 64;
+const unsigned int IBL_BRDF_SAMPLES   = 256;
+const float IBL_INTENSITY             = 0.3f;  // the sky is much brighter than the flat ambient it replaces
+const int IBL_TEXTURE_UNIT            = 14;    // prefiltered cubemap, the BRDF LUT on the next unit
+const unsigned int IBL_CACHE_VERSION  = 1;     // bump when the bake changes, old cache files are then ignored
+const char *const IBL_CACHE_DIRECTORY = "resources/cache/";
+
+
+// Image based lighting from the skybox: the diffuse irradiance as 9 spherical harmonics coefficients, a GGX
+// prefiltered specular cubemap with one roughness per mip and the split-sum BRDF lookup table. Everything is baked
+// on the CPU across the ThreadPool and written to IBL_CACHE_DIRECTORY under a ContentHash of the face files' contents,
+// so later runs load the result instead of baking; changing a face or the bake parameters yields a new file.
+//
+// The faces are used as they are loaded, without a linear conversion, the same way the rest of the renderer treats
+// its textures.
+class ImageBasedLighting
+{
+public:
+    bool Enabled = true;
+    float Intensity = IBL_INTENSITY;
+    bool FromCache = false;
+    float BakeMs = 0.0f;
+    unsigned int PrefilteredTexture = 0;   // RGB16F cubemap, IBL_PREFILTER_MIPS levels
+    unsigned int BrdfLutTexture = 0;       // RG16F, x = n.v, y = roughness
+    glm::vec3 SH[9];                       // irradiance / pi, ready for the basis evaluation in the shaders
+
+    // bakes or loads the lighting for the cubemap faces, in loadCubemap's order
+    bool Load(const std::vector<std::string> &faces)
+    {
+        uint64_t hash;
+        if (faces.size() != 6 || !hashFaces(faces, hash))
+            return false;
+        char name[32];
+        std::snprintf(name, sizeof(name), "ibl_%016llx.bin", (unsigned long long) hash);
+        std::string cachePath = std::string(IBL_CACHE_DIRECTORY) + name;
+
+        FromCache = readCache(cachePath);
+        if (!FromCache) {
+            auto start = std::chrono::steady_clock::now();
+            if (!bake(faces))
+                return false;
+            BakeMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+            std::cout << "IBL baked in " << BakeMs << " ms" << std::endl;
+            writeCache(cachePath);
+        }
+        upload();
+        return true;
+    }
+
+    // binds the textures and sets the uniforms of a shader that uses AmbientLight / SkyReflection
+    void Bind(Shader &shader) const
+    {
+        shader.use();
+        shader.setInt("iblEnabled", Enabled && PrefilteredTexture != 0);
+        shader.setFloat("iblIntensity", Intensity);
+        shader.setFloat("iblMaxLod", (float) (IBL_PREFILTER_MIPS - 1));
+        shader.setInt("iblPrefiltered", IBL_TEXTURE_UNIT);
+        shader.setInt("iblBrdfLut", IBL_TEXTURE_UNIT + 1);
+        for (int i = 0; i < 9; i++)
+            shader.setVec3("iblSH[" + std::to_string(i) + "]", SH[i]);
+        glActiveTexture(GL_TEXTURE0 + IBL_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, PrefilteredTexture);
+        glActiveTexture(GL_TEXTURE0 + IBL_TEXTURE_UNIT + 1);
+        glBindTexture(GL_TEXTURE_2D, BrdfLutTexture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void Destroy()
+    {
+        if (PrefilteredTexture != 0)
+            glDeleteTextures(1, &PrefilteredTexture);
+        if (BrdfLutTexture != 0)
+            glDeleteTextures(1, &BrdfLutTexture);
+        ResourceRegistry::Get().Untrack(RESOURCE_TEXTURE, PrefilteredTexture);
+        ResourceRegistry::Get().Untrack(RESOURCE_TEXTURE, BrdfLutTexture);
+        PrefilteredTexture = 0;
+        BrdfLutTexture = 0;
+    }
+
+private:
+    // one level of a cubemap on the CPU, RGB floats, face after face
+    struct CubeLevel {
+        int Size = 0;
+        std::vector<float> Texels;
+
+        glm::vec3 Fetch(int face, int x, int y) const
+        {
+            const float *texel = &Texels[(((size_t) face * Size + y) * Size + x) * 3];
+            return glm::vec3(texel[0], texel[1], texel[2]);
+        }
+    };
+
+    std::vector<float> prefiltered[IBL_PREFILTER_MIPS];
+    std::vector<float> brdfLut;
+
+    static bool hashFaces(const std::vector<std::string> &faces, uint64_t &hash)
+    {
+        const int parameters[] = {(int) IBL_CACHE_VERSION, IBL_SOURCE_SIZE, IBL_PREFILTER_SIZE, IBL_PREFILTER_MIPS,
+                                  (int) IBL_PREFILTER_SAMPLES, IBL_BRDF_LUT_SIZE, (int) IBL_BRDF_SAMPLES};
+        hash = ContentHash(parameters, sizeof(parameters));
+        std::vector<char> buffer(1 << 16);
+        for (const std::string &face : faces) {
+            std::ifstream in(face, std::ios::binary);
+            if (!in) {
+                std::cout << "ERROR::IBL:: Failed to read cubemap face: " << face << std::endl;
+                return false;
+            }
+            while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0)
+                hash = ContentHash(buffer.data(), (size_t) in.gcount(), hash);
+        }
+        return true;
+    }
+
+    // direction through (sc, tc) in [-1, 1] of a face, in the GL cubemap face layout
+    static glm::vec3 faceDirection(int face, float sc, float tc)
+    {
+        switch (face) {
+            case 0: return glm::vec3(1.0f, -tc, -sc);
+            case 1: return glm::vec3(-1.0f, -tc, sc);
+            case 2: return glm::vec3(sc, 1.0f, tc);
+            case 3: return glm::vec3(sc, -1.0f, -tc);
+            case 4: return glm::vec3(sc, -tc, 1.0f);
+            default: return glm::vec3(-sc, -tc, -1.0f);
+        }
+    }
+
+    // face and [0, 1] face coordinates a direction hits, the inverse of faceDirection
+    static int directionFace(const glm::vec3 &d, float &s, float &t)
+    {
+        glm::vec3 a = glm::abs(d);
+        int face;
+        float sc, tc, ma;
+        if (a.x >= a.y && a.x >= a.z) {
+            face = d.x > 0.0f ? 0 : 1;
+            sc = d.x > 0.0f ? -d.z : d.z;
+            tc = -d.y;
+            ma = a.x;
+        } else if (a.y >= a.z) {
+            face = d.y > 0.0f ? 2 : 3;
+            sc = d.x;
+            tc = d.y > 0.0f ? d.z : -d.z;
+            ma = a.y;
+        } else {
+            face = d.z > 0.0f ? 4 : 5;
+            sc = d.z > 0.0f ? d.x : -d.x;
+            tc = -d.y;
+            ma = a.z;
+        }
+        s = 0.5f * (sc / ma + 1.0f);
+        t = 0.5f * (tc / ma + 1.0f);
+        return face;
+    }
+
+    static glm::vec3 sampleLevel(const CubeLevel &level, const glm::vec3 &direction)
+    {
+        float s, t;
+        int face = directionFace(direction, s, t);
+        // bilinear inside the face, clamped at its edges
+        float x = std::min(std::max(s * level.Size - 0.5f, 0.0f), (float) (level.Size - 1));
+        float y = std::min(std::max(t * level.Size - 0.5f, 0.0f), (float) (level.Size - 1));
+        int x0 = (int) x, y0 = (int) y;
+        int x1 = std::min(x0 + 1, level.Size - 1), y1 = std::min(y0 + 1, level.Size - 1);
+        float fx = x - x0, fy = y - y0;
+        glm::vec3 top = level.Fetch(face, x0, y0) * (1.0f - fx) + level.Fetch(face, x1, y0) * fx;
+        glm::vec3 bottom = level.Fetch(face, x0, y1) * (1.0f - fx) + level.Fetch(face, x1, y1) * fx;
+        return top * (1.0f - fy) + bottom * fy;
+    }
+
+    static glm::vec3 sampleLod(const std::vector<CubeLevel> &pyramid, const glm::vec3 &direction, float lod)
+    {
+        lod = std::min(std::max(lod, 0.0f), (float) (pyramid.size() - 1));
+        int lower = (int) lod;
+        int upper = std::min(lower + 1, (int) pyramid.size() - 1);
+        float f = lod - lower;
+        return sampleLevel(pyramid[lower], direction) * (1.0f - f) + sampleLevel(pyramid[upper], direction) * f;
+    }
+
+    static glm::vec2 hammersley(unsigned int i, unsigned int count)
+    {
+        unsigned int bits = i;
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return glm::vec2((float) i / count, bits * 2.3283064365386963e-10f);
+    }
+
+    // GGX distributed half vector around n
+    static glm::vec3 importanceSampleGGX(const glm::vec2 &xi, const glm::vec3 &n, float roughness)
+    {
+        float a = roughness * roughness;
+        float phi = 2.0f * 3.14159265f * xi.x;
+        float cosTheta = std::sqrt((1.0f - xi.y) / (1.0f + (a * a - 1.0f) * xi.y));
+        float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+        glm::vec3 up = std::abs(n.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        glm::vec3 tangentX = glm::normalize(glm::cross(up, n));
+        glm::vec3 tangentY = glm::cross(n, tangentX);
+        return glm::normalize(tangentX * (std::cos(phi) * sinTheta) + tangentY * (std::sin(phi) * sinTheta) + n * cosTheta);
+    }
+
+    static float distributionGGX(float nDotH, float roughness)
+    {
+        float a2 = roughness * roughness * roughness * roughness;
+        float d = nDotH * nDotH * (a2 - 1.0f) + 1.0f;
+        return a2 / (3.14159265f * d * d);
+    }
+
+    bool bake(const std::vector<std::string> &faces)
+    {
+        std::vector<CubeLevel> pyramid;
+        if (!loadSource(faces, pyramid))
+            return false;
+        ThreadPool &pool = ThreadPool::Get();
+
+        projectSH(pyramid[std::min((size_t) 2, pyramid.size() - 1)]);
+
+        // prefiltered specular, N = V = R as in the split-sum approximation
+        float texelSolidAngle = 4.0f * 3.14159265f / (6.0f * pyramid[0].Size * pyramid[0].Size);
+        for (int mip = 0; mip < IBL_PREFILTER_MIPS; mip++) {
+            int size = std::max(IBL_PREFILTER_SIZE >> mip, 1);
+            float roughness = (float) mip / (IBL_PREFILTER_MIPS - 1);
+            std::vector<float> &texels = prefiltered[mip];
+            texels.assign((size_t) 6 * size * size * 3, 0.0f);
+            pool.ParallelFor(6 * size, [&](unsigned int row) {
+                int face = row / size, y = row % size;
+                for (int x = 0; x < size; x++) {
+                    glm::vec3 n = glm::normalize(faceDirection(face, 2.0f * (x + 0.5f) / size - 1.0f, 2.0f * (y + 0.5f) / size - 1.0f));
+                    glm::vec3 color(0.0f);
+                    if (mip == 0) {
+                        color = sampleLod(pyramid, n, std::log2((float) pyramid[0].Size / size));
+                    } else {
+                        float weight = 0.0f;
+                        for (unsigned int i = 0; i < IBL_PREFILTER_SAMPLES; i++) {
+                            glm::vec3 h = importanceSampleGGX(hammersley(i, IBL_PREFILTER_SAMPLES), n, roughness);
+                            glm::vec3 l = h * (2.0f * glm::dot(n, h)) - n;
+                            float nDotL = glm::dot(n, l);
+                            if (nDotL <= 0.0f)
+                                continue;
+                            // sample the level whose texels cover the sample's solid angle, it hides the undersampling
+                            float pdf = distributionGGX(std::max(glm::dot(n, h), 0.0f), roughness) * 0.25f;
+                            float sampleSolidAngle = 1.0f / (IBL_PREFILTER_SAMPLES * pdf + 1.0e-4f);
+                            float lod = 0.5f * std::log2(sampleSolidAngle / texelSolidAngle) + 1.0f;
+                            color += sampleLod(pyramid, l, lod) * nDotL;
+                            weight += nDotL;
+                        }
+                        color = color / std::max(weight, 1.0e-4f);
+                    }
+                    float *texel = &texels[(((size_t) face * size + y) * size + x) * 3];
+                    texel[0] = color.x;
+                    texel[1] = color.y;
+                    texel[2] = color.z;
+                }
+            });
+        }
+
+        // split-sum BRDF: scale and bias applied to F0
+        brdfLut.assign((size_t) IBL_BRDF_LUT_SIZE * IBL_BRDF_LUT_SIZE * 2, 0.0f);
+        pool.ParallelFor(IBL_BRDF_LUT_SIZE, [&](unsigned int row) {
+            float roughness = (row + 0.5f) / IBL_BRDF_LUT_SIZE;
+            float k = roughness * roughness / 2.0f;
+            for (int column = 0; column < IBL_BRDF_LUT_SIZE; column++) {
+                float nDotV = (column + 0.5f) / IBL_BRDF_LUT_SIZE;
+                glm::vec3 v(std::sqrt(1.0f - nDotV * nDotV), 0.0f, nDotV);
+                glm::vec3 n(0.0f, 0.0f, 1.0f);
+                float scale = 0.0f, bias = 0.0f;
+                for (unsigned int i = 0; i < IBL_BRDF_SAMPLES; i++) {
+                    glm::vec3 h = importanceSampleGGX(hammersley(i, IBL_BRDF_SAMPLES), n, roughness);
+                    float vDotH = glm::dot(v, h);
+                    glm::vec3 l = h * (2.0f * vDotH) - v;
+                    float nDotL = std::max(l.z, 0.0f);
+                    if (nDotL <= 0.0f)
+                        continue;
+                    float nDotH = std::max(h.z, 0.0f);
+                    vDotH = std::max(vDotH, 0.0f);
+                    float g = (nDotV / (nDotV * (1.0f - k) + k)) * (nDotL / (nDotL * (1.0f - k) + k));
+                    float visibility = g * vDotH / (nDotH * nDotV);
+                    float fresnel = std::pow(1.0f - vDotH, 5.0f);
+                    scale += (1.0f - fresnel) * visibility;
+                    bias += fresnel * visibility;
+                }
+                float *texel = &brdfLut[((size_t) row * IBL_BRDF_LUT_SIZE + column) * 2];
+                texel[0] = scale / IBL_BRDF_SAMPLES;
+                texel[1] = bias / IBL_BRDF_SAMPLES;
+            }
+        });
+        return true;
+    }
+
+    // the faces box filtered to IBL_SOURCE_SIZE (or their own size if smaller), then halved down to 1x1
+    static bool loadSource(const std::vector<std::string> &faces, std::vector<CubeLevel> &pyramid)
+    {
+        CubeLevel base;
+        for (int face = 0; face < 6; face++) {
+            int width, height, channels;
+            unsigned char *data = stbi_load(faces[face].c_str(), &width, &height, &channels, 3);
+            if (!data) {
+                std::cout << "ERROR::IBL:: Failed to load cubemap face: " << faces[face] << std::endl;
+                return false;
+            }
+            if (face == 0) {
+                base.Size = std::min(std::min(width, height), IBL_SOURCE_SIZE);
+                base.Texels.assign((size_t) 6 * base.Size * base.Size * 3, 0.0f);
+            }
+            for (int y = 0; y < base.Size; y++) {
+                int y0 = y * height / base.Size, y1 = std::max((y + 1) * height / base.Size, y0 + 1);
+                for (int x = 0; x < base.Size; x++) {
+                    int x0 = x * width / base.Size, x1 = std::max((x + 1) * width / base.Size, x0 + 1);
+                    float sum[3] = {0.0f, 0.0f, 0.0f};
+                    for (int sy = y0; sy < y1; sy++)
+                        for (int sx = x0; sx < x1; sx++)
+                            for (int c = 0; c < 3; c++)
+                                sum[c] += data[((size_t) sy * width + sx) * 3 + c];
+                    float *texel = &base.Texels[(((size_t) face * base.Size + y) * base.Size + x) * 3];
+                    for (int c = 0; c < 3; c++)
+                        texel[c] = sum[c] / (255.0f * (x1 - x0) * (y1 - y0));
+                }
+            }
+            stbi_image_free(data);
+        }
+
+        pyramid.clear();
+        pyramid.push_back(base);
+        while (pyramid.back().Size > 1) {
+            const CubeLevel &previous = pyramid.back();
+            CubeLevel level;
+            level.Size = previous.Size / 2;
+            level.Texels.resize((size_t) 6 * level.Size * level.Size * 3);
+            for (int face = 0; face < 6; face++)
+                for (int y = 0; y < level.Size; y++)
+                    for (int x = 0; x < level.Size; x++) {
+                        glm::vec3 sum = previous.Fetch(face, 2 * x, 2 * y) + previous.Fetch(face, 2 * x + 1, 2 * y) +
+                                        previous.Fetch(face, 2 * x, 2 * y + 1) + previous.Fetch(face, 2 * x + 1, 2 * y + 1);
+                        float *texel = &level.Texels[(((size_t) face * level.Size + y) * level.Size + x) * 3];
+                        texel[0] = sum.x * 0.25f;
+                        texel[1] = sum.y * 0.25f;
+                        texel[2] = sum.z * 0.25f;
+                    }
+            pyramid.push_back(level);
+        }
+        return true;
+    }
+
+    // projects the radiance onto the first 9 SH basis functions and convolves them with the clamped cosine
+    void projectSH(const CubeLevel &level)
+    {
+        double sh[9][3] = {};
+        for (int face = 0; face < 6; face++)
+            for (int y = 0; y < level.Size; y++)
+                for (int x = 0; x < level.Size; x++) {
+                    float sc = 2.0f * (x + 0.5f) / level.Size - 1.0f;
+                    float tc = 2.0f * (y + 0.5f) / level.Size - 1.0f;
+                    // solid angle of the texel
+                    float texelSize = 2.0f / level.Size;
+                    float solidAngle = texelSize * texelSize / std::pow(1.0f + sc * sc + tc * tc, 1.5f);
+                    glm::vec3 d = glm::normalize(faceDirection(face, sc, tc));
+                    float basis[9] = {0.282095f,
+                                      0.488603f * d.y, 0.488603f * d.z, 0.488603f * d.x,
+                                      1.092548f * d.x * d.y, 1.092548f * d.y * d.z, 0.315392f * (3.0f * d.z * d.z - 1.0f),
+                                      1.092548f * d.x * d.z, 0.546274f * (d.x * d.x - d.y * d.y)};
+                    glm::vec3 color = level.Fetch(face, x, y);
+                    for (int i = 0; i < 9; i++) {
+                        sh[i][0] += color.x * basis[i] * solidAngle;
+                        sh[i][1] += color.y * basis[i] * solidAngle;
+                        sh[i][2] += color.z * basis[i] * solidAngle;
+                    }
+                }
+        // cosine lobe per band (pi, 2pi/3, pi/4), divided by pi for a Lambertian surface
+        const float band[9] = {1.0f, 2.0f / 3.0f, 2.0f / 3.0f, 2.0f / 3.0f, 0.25f, 0.25f, 0.25f, 0.25f, 0.25f};
+        for (int i = 0; i < 9; i++)
+            SH[i] = glm::vec3((float) sh[i][0], (float) sh[i][1], (float) sh[i][2]) * band[i];
+    }
+
+    bool readCache(const std::string &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+        unsigned int version = 0;
+        in.read((char *) &version, sizeof(version));
+        if (!in || version != IBL_CACHE_VERSION)
+            return false;
+        for (int i = 0; i < 9; i++)
+            in.read((char *) &SH[i], sizeof(float) * 3);
+        for (int mip = 0; mip < IBL_PREFILTER_MIPS; mip++) {
+            int size = std::max(IBL_PREFILTER_SIZE >> mip, 1);
+            prefiltered[mip].resize((size_t) 6 * size * size * 3);
+            in.read((char *) prefiltered[mip].data(), prefiltered[mip].size() * sizeof(float));
+        }
+        brdfLut.resize((size_t) IBL_BRDF_LUT_SIZE * IBL_BRDF_LUT_SIZE * 2);
+        in.read((char *) brdfLut.data(), brdfLut.size() * sizeof(float));
+        if (!in) {
+            std::cout << "ERROR::IBL:: Cache file is truncated, baking again: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    void writeCache(const std::string &path) const
+    {
+        std::ofstream out(path, std::ios::binary);
+        out.write((const char *) &IBL_CACHE_VERSION, sizeof(IBL_CACHE_VERSION));
+        for (int i = 0; i < 9; i++)
+            out.write((const char *) &SH[i], sizeof(float) * 3);
+        for (int mip = 0; mip < IBL_PREFILTER_MIPS; mip++)
+            out.write((const char *) prefiltered[mip].data(), prefiltered[mip].size() * sizeof(float));
+        out.write((const char *) brdfLut.data(), brdfLut.size() * sizeof(float));
+        if (!out)
+            std::cout << "ERROR::IBL:: Failed to write cache file: " << path << std::endl;
+    }
+
+    void upload()
+    {
+        if (PrefilteredTexture == 0)
+            glGenTextures(1, &PrefilteredTexture);
+        glBindTexture(GL_TEXTURE_CUBE_MAP, PrefilteredTexture);
+        size_t prefilteredBytes = 0;
+        for (int mip = 0; mip < IBL_PREFILTER_MIPS; mip++) {
+            int size = std::max(IBL_PREFILTER_SIZE >> mip, 1);
+            for (int face = 0; face < 6; face++)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, mip, GL_RGB16F, size, size, 0, GL_RGB, GL_FLOAT,
+                             &prefiltered[mip][(size_t) face * size * size * 3]);
+            prefilteredBytes += ResourceRegistry::TextureBytes(size, size, 6) * 6;
+        }
+        ResourceRegistry::Get().Track(RESOURCE_TEXTURE, PrefilteredTexture, prefilteredBytes, "Sky prefiltered radiance");
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, IBL_PREFILTER_MIPS - 1);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        // the rough levels are only a few texels wide, filtering across faces hides their seams
+        glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
+
+        if (BrdfLutTexture == 0)
+            glGenTextures(1, &BrdfLutTexture);
+        glBindTexture(GL_TEXTURE_2D, BrdfLutTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, IBL_BRDF_LUT_SIZE, IBL_BRDF_LUT_SIZE, 0, GL_RG, GL_FLOAT, brdfLut.data());
+        ResourceRegistry::Get().Track(RESOURCE_TEXTURE, BrdfLutTexture,
+                                      ResourceRegistry::TextureBytes(IBL_BRDF_LUT_SIZE, IBL_BRDF_LUT_SIZE, 4), "BRDF lookup table");
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+};
+#endif
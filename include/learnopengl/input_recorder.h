@@ -0,0 +1,177 @@
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#include <learnopengl/camera.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Bits of InputStep::Flags. The low four are the movement keys, the others say which optional values follow.
+enum Input_Flags {
+    INPUT_FORWARD    = 1 << 0,
+    INPUT_BACKWARD   = 1 << 1,
+    INPUT_LEFT       = 1 << 2,
+    INPUT_RIGHT      = 1 << 3,
+    INPUT_HAS_MOUSE  = 1 << 4,
+    INPUT_HAS_SCROLL = 1 << 5
+};
+
+const char INPUT_LOG_MAGIC[4]       = {'R', 'G', 'I', 'N'};
+const uint32_t INPUT_LOG_VERSION    = 1;
+const unsigned int REPLAY_STEPS_PER_FRAME = 2;   // replayed frames advance a fixed amount of simulated time
+
+
+// everything the simulation consumes during one fixed timestep
+struct InputStep {
+    unsigned char Flags = 0;
+    float MouseX = 0.0f, MouseY = 0.0f;   // offsets as passed to Camera::ProcessMouseMovement
+    float Scroll = 0.0f;                  // offset as passed to Camera::ProcessMouseScroll
+};
+
+// Writes the input consumed by every fixed simulation step to a compact binary log. The step index is the
+// timestamp, so a step without input costs a single byte. The header stores the timestep and the camera state
+// the recording started from.
+//
+// Layout (host byte order): magic "RGIN", uint32 version, float timestep, float position[3], float yaw,
+// float pitch, float zoom, then per step: uint8 flags [, float mouseX, float mouseY] [, float scroll]
+class InputRecorder
+{
+public:
+    unsigned int StepCount = 0;
+
+    bool Start(const std::string &path, const Camera &camera, float timestep)
+    {
+        out.open(path, std::ios::binary | std::ios::trunc);
+        if (!out) {
+            std::cout << "ERROR::INPUT_RECORDER:: Could not open " << path << " for writing" << std::endl;
+            return false;
+        }
+        out.write(INPUT_LOG_MAGIC, sizeof(INPUT_LOG_MAGIC));
+        write(INPUT_LOG_VERSION);
+        write(timestep);
+        write(camera.Position.x);
+        write(camera.Position.y);
+        write(camera.Position.z);
+        // the angles of the direction the camera actually faces, which replay rebuilds Front from
+        float yaw, pitch;
+        Camera::OrientationOf(camera.Front, yaw, pitch);
+        write(yaw);
+        write(pitch);
+        write(camera.Zoom);
+        StepCount = 0;
+        return true;
+    }
+
+    bool Recording() const
+    {
+        return out.is_open();
+    }
+
+    void Record(const InputStep &step)
+    {
+        if (!Recording())
+            return;
+        out.put((char) step.Flags);
+        if (step.Flags & INPUT_HAS_MOUSE) {
+            write(step.MouseX);
+            write(step.MouseY);
+        }
+        if (step.Flags & INPUT_HAS_SCROLL)
+            write(step.Scroll);
+        StepCount++;
+    }
+
+    void Stop()
+    {
+        if (!Recording())
+            return;
+        out.close();
+        std::cout << "Recorded " << StepCount << " input steps" << std::endl;
+    }
+
+private:
+    std::ofstream out;
+
+    template <typename T>
+    void write(const T &value)
+    {
+        out.write((const char *) &value, sizeof(T));
+    }
+};
+
+// Reads a log written by InputRecorder and hands its steps back one at a time.
+class InputReplay
+{
+public:
+    float Timestep = 0.0f;
+
+    // loads the whole log and puts the camera into the state the recording started from
+    bool Open(const std::string &path, Camera &camera)
+    {
+        std::ifstream in(path, std::ios::binary);
+        data.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        position = 0;
+
+        char magic[4];
+        uint32_t version = 0;
+        glm::vec3 start;
+        float yaw, pitch, zoom;
+        bool valid = read(magic) && std::equal(magic, magic + 4, INPUT_LOG_MAGIC) && read(version) &&
+                     version == INPUT_LOG_VERSION && read(Timestep) && read(start.x) && read(start.y) &&
+                     read(start.z) && read(yaw) && read(pitch) && read(zoom);
+        if (!valid) {
+            std::cout << "ERROR::INPUT_REPLAY:: " << path << " is not a valid input log" << std::endl;
+            data.clear();
+            return false;
+        }
+
+        camera.Position = start;
+        camera.PreviousPosition = start;
+        camera.Zoom = zoom;
+        camera.SetOrientation(yaw, pitch);
+        return true;
+    }
+
+    bool Active() const
+    {
+        return position < data.size();
+    }
+
+    // returns false once the log is exhausted
+    bool Next(InputStep &step)
+    {
+        if (!Active())
+            return false;
+        step = InputStep();
+        step.Flags = (unsigned char) data[position++];
+        bool complete = true;
+        if (step.Flags & INPUT_HAS_MOUSE)
+            complete = read(step.MouseX) && read(step.MouseY);
+        if (complete && (step.Flags & INPUT_HAS_SCROLL))
+            complete = read(step.Scroll);
+        if (!complete)
+            position = data.size();
+        return complete;
+    }
+
+private:
+    std::vector<char> data;
+    size_t position = 0;
+
+    template <typename T>
+    bool read(T &value)
+    {
+        if (position + sizeof(T) > data.size())
+            return false;
+        std::copy(data.begin() + position, data.begin() + position + sizeof(T), (char *) &value);
+        position += sizeof(T);
+        return true;
+    }
+};
+#endif
@@ -0,0 +1,358 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/lights.h>
+#include <learnopengl/resource_registry.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/stream_buffer.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define LIGHT_CLUSTERS_SSE
+#endif
+
+// Default light cluster values
+const unsigned int CLUSTERS_X = 16;
+const unsigned int CLUSTERS_Y = 9;
+const unsigned int CLUSTERS_Z = 24;     // depth slices, exponentially spaced between the near and far plane
+const int CLUSTER_TEXTURE_UNIT = 10;    // units 10..12, above anything the materials use
+
+
+// Clustered forward shading. The view frustum is divided into CLUSTERS_X x CLUSTERS_Y screen tiles times CLUSTERS_Z
+// depth slices. Every frame the CPU intersects each light's bounding sphere (see LightRadius) with the clusters and
+// uploads, through texture buffer objects:
+//   grid     (RG32UI)   per cluster: offset into the index list, number of lights
+//   indices  (R32UI)    light indices, cluster after cluster
+//   lights   (RGBA32F)  4 texels per light: position + constant, ambient + linear, diffuse + quadratic,
+//                       specular + radius
+// All three are written into the StreamBuffer, so the texture buffers cover the whole ring and the shaders add
+// clusterBase, the first texel of this frame's lists, to every fetch. A fragment finds its cluster from gl_FragCoord
+// and its view depth and loops over that cluster's lights only. When the ring has no room for them (it is limited by
+// GL_MAX_TEXTURE_BUFFER_SIZE), the lists go into buffers of their own for that frame, and an index list longer than
+// that limit is cut short, dropping the lights of the last clusters.
+//
+// Depth slices are independent, so they are built in parallel on the ThreadPool; within a slice the sphere/box
+// tests run on four lights at once with SSE.
+class LightClusters
+{
+public:
+    unsigned int LightIndexCount = 0;   // entries in the index list of the last build
+    unsigned int MaxClusterLights = 0;  // most lights in a single cluster
+    unsigned int DroppedIndices = 0;    // entries cut from the index list, over GL_MAX_TEXTURE_BUFFER_SIZE
+    bool OwnBuffers = false;            // the last lists did not fit the StreamBuffer
+
+    void Build(const glm::mat4 &view, float fovY, float aspect, float nearPlane, float farPlane,
+               const std::vector<PointLight> &lights)
+    {
+        clusterNear = nearPlane;
+        clusterFar = farPlane;
+        computeClusterBounds(fovY, aspect);
+
+        // lights in view space, structure of arrays for the SIMD tests; depth is positive in front of the camera
+        size_t count = lights.size();
+        lightX.resize(count);
+        lightY.resize(count);
+        lightDepth.resize(count);
+        lightRadius.resize(count);
+        for (size_t i = 0; i < count; i++) {
+            glm::vec3 position = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+            lightX[i] = position.x;
+            lightY[i] = position.y;
+            lightDepth[i] = -position.z;
+            lightRadius[i] = LightRadius(lights[i]);
+        }
+
+        slices.resize(CLUSTERS_Z);
+        ThreadPool::Get().ParallelFor(CLUSTERS_Z, [this](unsigned int z) { buildSlice(z); });
+
+        // concatenate the slices' lists into one index buffer, no longer than a buffer texture can address
+        if (maxTexels == 0) {
+            GLint limit = 0;
+            glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &limit);
+            maxTexels = (unsigned int) std::max(limit, 65536);
+        }
+        grid.resize(CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z * 2);
+        indices.clear();
+        MaxClusterLights = 0;
+        DroppedIndices = 0;
+        for (unsigned int z = 0; z < CLUSTERS_Z; z++) {
+            const Slice &slice = slices[z];
+            unsigned int base = (unsigned int) indices.size();
+            unsigned int kept = std::min((unsigned int) slice.Indices.size(), maxTexels - base);
+            for (unsigned int tile = 0; tile < CLUSTERS_X * CLUSTERS_Y; tile++) {
+                unsigned int cluster = z * CLUSTERS_X * CLUSTERS_Y + tile;
+                unsigned int offset = std::min(slice.Offsets[tile], kept);
+                grid[cluster * 2] = base + offset;
+                grid[cluster * 2 + 1] = std::min(slice.Counts[tile], kept - offset);
+                MaxClusterLights = std::max(MaxClusterLights, slice.Counts[tile]);
+            }
+            indices.insert(indices.end(), slice.Indices.begin(), slice.Indices.begin() + kept);
+            DroppedIndices += (unsigned int) slice.Indices.size() - kept;
+        }
+        LightIndexCount = (unsigned int) indices.size();
+        if (indices.empty())
+            indices.push_back(0);   // a buffer texture needs some storage
+
+        lightData.resize(std::max(count, (size_t) 1) * 16);
+        for (size_t i = 0; i < count; i++) {
+            const PointLight &light = lights[i];
+            float *texels = &lightData[i * 16];
+            setTexel(texels, light.position, light.constant);
+            setTexel(texels + 4, light.ambient, light.linear);
+            setTexel(texels + 8, light.diffuse, light.quadratic);
+            setTexel(texels + 12, light.specular, lightRadius[i]);
+        }
+        upload();
+    }
+
+    // binds the buffers and sets the cluster uniforms of a shader that includes the clustered lighting loop
+    void Bind(Shader &shader, int viewportWidth, int viewportHeight) const
+    {
+        shader.use();
+        shader.setInt("clustered", 1);
+        shader.setVec2("clusterViewport", glm::vec2((float) viewportWidth, (float) viewportHeight));
+        shader.setFloat("clusterNear", clusterNear);
+        shader.setFloat("clusterFar", clusterFar);
+        shader.setVec3("clusterDims", glm::vec3((float) CLUSTERS_X, (float) CLUSTERS_Y, (float) CLUSTERS_Z));
+        shader.setIVec3("clusterBase", base[0], base[1], base[2]);
+        for (int i = 0; i < 3; i++) {
+            glActiveTexture(GL_TEXTURE0 + CLUSTER_TEXTURE_UNIT + i);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        }
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // assigns the cluster samplers their units once; without it they would share unit 0 with the material's
+    // sampler2D, which is an invalid draw even when clustering is off
+    static void SetupShader(Shader &shader)
+    {
+        shader.use();
+        shader.setInt("clusterGrid", CLUSTER_TEXTURE_UNIT);
+        shader.setInt("clusterLightIndices", CLUSTER_TEXTURE_UNIT + 1);
+        shader.setInt("clusterLights", CLUSTER_TEXTURE_UNIT + 2);
+        shader.setInt("clustered", 0);
+    }
+
+    void Destroy()
+    {
+        if (textures[0] == 0)
+            return;
+        glDeleteTextures(3, textures);
+        textures[0] = 0;
+        streamBuffer = 0;
+        if (buffers[0] != 0) {
+            glDeleteBuffers(3, buffers);
+            for (unsigned int buffer : buffers)
+                ResourceRegistry::Get().Untrack(RESOURCE_BUFFER, buffer);
+            buffers[0] = 0;
+        }
+    }
+
+private:
+    struct Slice {
+        std::vector<unsigned int> Offsets = std::vector<unsigned int>(CLUSTERS_X * CLUSTERS_Y);
+        std::vector<unsigned int> Counts = std::vector<unsigned int>(CLUSTERS_X * CLUSTERS_Y);
+        std::vector<unsigned int> Indices;
+        std::vector<unsigned int> Candidates;
+        std::vector<float> X, Y, Depth, RadiusSquared;   // candidates, padded to a multiple of 4
+    };
+
+    float clusterNear = 0.1f, clusterFar = 100.0f;
+    std::vector<float> sliceDepths;     // CLUSTERS_Z + 1 boundaries
+    std::vector<float> tileMinX, tileMaxX, tileMinY, tileMaxY;   // view space bounds per slice and tile
+
+    std::vector<float> lightX, lightY, lightDepth, lightRadius;
+    std::vector<Slice> slices;
+    std::vector<unsigned int> grid;
+    std::vector<unsigned int> indices;
+    std::vector<float> lightData;
+
+    GLuint textures[3] = {0, 0, 0};
+    GLuint buffers[3] = {0, 0, 0};   // used when the lists do not fit the StreamBuffer
+    unsigned int maxTexels = 0;      // GL_MAX_TEXTURE_BUFFER_SIZE
+    GLuint streamBuffer = 0;           // the StreamBuffer ring the textures cover
+    GLint base[3] = {0, 0, 0};         // first texel of the grid, the indices and the lights
+
+    // the clusters' view space boxes: a tile spans [ndcMin, ndcMax] * depth * tan(fov / 2), so its x/y extent over
+    // a slice is found at the slice's near or far depth
+    void computeClusterBounds(float fovY, float aspect)
+    {
+        sliceDepths.resize(CLUSTERS_Z + 1);
+        for (unsigned int z = 0; z <= CLUSTERS_Z; z++)
+            sliceDepths[z] = clusterNear * std::pow(clusterFar / clusterNear, (float) z / CLUSTERS_Z);
+
+        float tanY = std::tan(fovY * 0.5f);
+        float tanX = tanY * aspect;
+        size_t size = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+        tileMinX.resize(size);
+        tileMaxX.resize(size);
+        tileMinY.resize(size);
+        tileMaxY.resize(size);
+        for (unsigned int z = 0; z < CLUSTERS_Z; z++) {
+            float d0 = sliceDepths[z], d1 = sliceDepths[z + 1];
+            for (unsigned int y = 0; y < CLUSTERS_Y; y++) {
+                float y0 = (-1.0f + 2.0f * y / CLUSTERS_Y) * tanY, y1 = (-1.0f + 2.0f * (y + 1) / CLUSTERS_Y) * tanY;
+                for (unsigned int x = 0; x < CLUSTERS_X; x++) {
+                    float x0 = (-1.0f + 2.0f * x / CLUSTERS_X) * tanX, x1 = (-1.0f + 2.0f * (x + 1) / CLUSTERS_X) * tanX;
+                    size_t cluster = (z * CLUSTERS_Y + y) * CLUSTERS_X + x;
+                    tileMinX[cluster] = std::min(x0 * d0, x0 * d1);
+                    tileMaxX[cluster] = std::max(x1 * d0, x1 * d1);
+                    tileMinY[cluster] = std::min(y0 * d0, y0 * d1);
+                    tileMaxY[cluster] = std::max(y1 * d0, y1 * d1);
+                }
+            }
+        }
+    }
+
+    void buildSlice(unsigned int z)
+    {
+        Slice &slice = slices[z];
+        float d0 = sliceDepths[z], d1 = sliceDepths[z + 1];
+
+        // lights whose depth range overlaps the slice
+        slice.Candidates.clear();
+        slice.X.clear();
+        slice.Y.clear();
+        slice.Depth.clear();
+        slice.RadiusSquared.clear();
+        for (unsigned int i = 0; i < lightX.size(); i++) {
+            if (lightRadius[i] <= 0.0f || lightDepth[i] + lightRadius[i] < d0 || lightDepth[i] - lightRadius[i] > d1)
+                continue;
+            slice.Candidates.push_back(i);
+            slice.X.push_back(lightX[i]);
+            slice.Y.push_back(lightY[i]);
+            slice.Depth.push_back(lightDepth[i]);
+            slice.RadiusSquared.push_back(lightRadius[i] * lightRadius[i]);
+        }
+        // padding never intersects anything
+        while (slice.X.size() % 4 != 0) {
+            slice.X.push_back(0.0f);
+            slice.Y.push_back(0.0f);
+            slice.Depth.push_back(0.0f);
+            slice.RadiusSquared.push_back(-1.0f);
+        }
+
+        slice.Indices.clear();
+        for (unsigned int tile = 0; tile < CLUSTERS_X * CLUSTERS_Y; tile++) {
+            size_t cluster = z * CLUSTERS_X * CLUSTERS_Y + tile;
+            slice.Offsets[tile] = (unsigned int) slice.Indices.size();
+            intersect(slice, tileMinX[cluster], tileMaxX[cluster], tileMinY[cluster], tileMaxY[cluster], d0, d1);
+            slice.Counts[tile] = (unsigned int) slice.Indices.size() - slice.Offsets[tile];
+        }
+    }
+
+    // appends every candidate whose sphere touches the box; the squared distance from the center to the box is
+    // compared with the squared radius
+    static void intersect(Slice &slice, float minX, float maxX, float minY, float maxY, float minDepth, float maxDepth)
+    {
+        size_t count = slice.X.size();
+#ifdef LIGHT_CLUSTERS_SSE
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 boxMinX = _mm_set1_ps(minX), boxMaxX = _mm_set1_ps(maxX);
+        const __m128 boxMinY = _mm_set1_ps(minY), boxMaxY = _mm_set1_ps(maxY);
+        const __m128 boxMinZ = _mm_set1_ps(minDepth), boxMaxZ = _mm_set1_ps(maxDepth);
+        for (size_t i = 0; i < count; i += 4) {
+            __m128 x = _mm_loadu_ps(&slice.X[i]);
+            __m128 y = _mm_loadu_ps(&slice.Y[i]);
+            __m128 z = _mm_loadu_ps(&slice.Depth[i]);
+            __m128 dx = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(boxMinX, x), _mm_sub_ps(x, boxMaxX)));
+            __m128 dy = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(boxMinY, y), _mm_sub_ps(y, boxMaxY)));
+            __m128 dz = _mm_max_ps(zero, _mm_max_ps(_mm_sub_ps(boxMinZ, z), _mm_sub_ps(z, boxMaxZ)));
+            __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+            int mask = _mm_movemask_ps(_mm_cmple_ps(distance, _mm_loadu_ps(&slice.RadiusSquared[i])));
+            for (int lane = 0; mask != 0; lane++, mask >>= 1)
+                if (mask & 1)
+                    slice.Indices.push_back(slice.Candidates[i + lane]);
+        }
+#else
+        for (size_t i = 0; i < count; i++) {
+            float dx = std::max(0.0f, std::max(minX - slice.X[i], slice.X[i] - maxX));
+            float dy = std::max(0.0f, std::max(minY - slice.Y[i], slice.Y[i] - maxY));
+            float dz = std::max(0.0f, std::max(minDepth - slice.Depth[i], slice.Depth[i] - maxDepth));
+            if (dx * dx + dy * dy + dz * dz <= slice.RadiusSquared[i])
+                slice.Indices.push_back(slice.Candidates[i]);
+        }
+#endif
+    }
+
+    static void setTexel(float *texel, const glm::vec3 &rgb, float w)
+    {
+        texel[0] = rgb.x;
+        texel[1] = rgb.y;
+        texel[2] = rgb.z;
+        texel[3] = w;
+    }
+
+    // one StreamBuffer allocation for the three lists, behind the ones draws of earlier frames may still read, so
+    // the upload never waits for the GPU
+    void upload()
+    {
+        if (textures[0] == 0)
+            glGenTextures(3, textures);
+        const GLenum formats[] = {GL_RG32UI, GL_R32UI, GL_RGBA32F};
+        const size_t texelBytes[] = {8, 4, 16};
+        const void *data[] = {grid.data(), indices.data(), lightData.data()};
+        const size_t sizes[] = {grid.size() * sizeof(unsigned int), indices.size() * sizeof(unsigned int),
+                                lightData.size() * sizeof(float)};
+        size_t offsets[3], total = 0;
+        for (int i = 0; i < 3; i++) {
+            offsets[i] = total;   // STREAM_BUFFER_ALIGNMENT apart, a multiple of every texel size
+            total += (sizes[i] + STREAM_BUFFER_ALIGNMENT - 1) & ~(STREAM_BUFFER_ALIGNMENT - 1);
+        }
+
+        StreamBuffer &stream = StreamBuffer::Get();
+        size_t offset;
+        unsigned char *target = (unsigned char *) stream.Map(total, offset);
+        OwnBuffers = target == nullptr;
+        if (OwnBuffers) {
+            uploadOwn(formats, data, sizes);
+            return;
+        }
+        for (int i = 0; i < 3; i++) {
+            std::memcpy(target + offsets[i], data[i], sizes[i]);
+            base[i] = (GLint) ((offset + offsets[i]) / texelBytes[i]);
+        }
+        stream.Unmap();
+
+        if (streamBuffer != stream.Buffer()) {   // first frame, or the ring grew
+            streamBuffer = stream.Buffer();
+            for (int i = 0; i < 3; i++) {
+                glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+                glTexBuffer(GL_TEXTURE_BUFFER, formats[i], streamBuffer);
+            }
+            glBindTexture(GL_TEXTURE_BUFFER, 0);
+        }
+    }
+
+    // the fallback: each list in a buffer of its own, orphaned so the upload does not wait for draws still reading
+    // the previous lists
+    void uploadOwn(const GLenum *formats, const void *const *data, const size_t *sizes)
+    {
+        if (buffers[0] == 0)
+            glGenBuffers(3, buffers);
+        const char *const names[] = {"Light cluster grid", "Light cluster indices", "Light cluster lights"};
+        for (int i = 0; i < 3; i++) {
+            glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+            glBufferData(GL_TEXTURE_BUFFER, sizes[i], NULL, GL_STREAM_DRAW);
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, sizes[i], data[i]);
+            ResourceRegistry::Get().Track(RESOURCE_BUFFER, buffers[i], sizes[i], names[i]);
+            glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+            base[i] = 0;
+        }
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+        streamBuffer = 0;   // rebinds the ring once it has room again
+    }
+};
+#endif
@@ -0,0 +1,79 @@
+#ifndef LIGHTS_H
+#define LIGHTS_H
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// Default light values
+const float LIGHT_CUTOFF            = 5.0f / 256.0f;  // attenuated brightness below which a light is ignored
+const unsigned int MAX_SCENE_LIGHTS = 4096;
+
+
+struct PointLight{
+    glm::vec3 position;
+
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+struct DirLight{
+    glm::vec3 direction;
+
+    glm::vec3 ambient;
+    glm::vec3 diffuse;
+    glm::vec3 specular;
+};
+
+// distance at which the light's attenuation brings its brightest channel below LIGHT_CUTOFF; everything a light
+// volume or cluster has to cover
+inline float LightRadius(const PointLight &light)
+{
+    glm::vec3 brightest = glm::max(glm::max(light.ambient, light.diffuse), light.specular);
+    float maxChannel = std::max(std::max(brightest.r, brightest.g), brightest.b);
+    // solve constant + linear * d + quadratic * d^2 = maxChannel / LIGHT_CUTOFF
+    float c = light.constant - maxChannel / LIGHT_CUTOFF;
+    if (c >= 0.0f)
+        return 0.0f;
+    if (light.quadratic <= 0.0f)
+        return light.linear > 0.0f ? -c / light.linear : 1.0e4f;
+    return (-light.linear + std::sqrt(light.linear * light.linear - 4.0f * light.quadratic * c)) / (2.0f * light.quadratic);
+}
+
+// Small colored lights ("fireflies") scattered over the meadow, for testing the many-light render paths. The
+// sequence depends only on the index, so every run and every platform sees the same lights.
+inline std::vector<PointLight> ScatterPointLights(unsigned int count)
+{
+    auto random = [](unsigned int index, unsigned int channel) {
+        unsigned int x = index * 0x9e3779b9u + channel * 0x85ebca6bu + 0x27d4eb2fu;
+        x ^= x >> 16;
+        x *= 0x7feb352du;
+        x ^= x >> 15;
+        x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return (x & 0xffffffu) / (float) 0x1000000;
+    };
+
+    std::vector<PointLight> lights(std::min(count, MAX_SCENE_LIGHTS));
+    for (unsigned int i = 0; i < lights.size(); i++) {
+        PointLight &light = lights[i];
+        light.position = glm::vec3(-14.0f + 28.0f * random(i, 0), -0.9f + 1.5f * random(i, 1), -14.0f + 28.0f * random(i, 2));
+        glm::vec3 color = glm::vec3(random(i, 3), random(i, 4), random(i, 5));
+        color /= std::max(std::max(color.r, color.g), std::max(color.b, 0.01f));
+        light.ambient = glm::vec3(0.0f);
+        light.diffuse = color * 0.6f;
+        light.specular = color * 0.3f;
+        light.constant = 1.0f;     // reaches about 2 units, see LightRadius
+        light.linear = 1.4f;
+        light.quadratic = 6.0f;
+    }
+    return lights;
+}
+#endif
@@ -0,0 +1,205 @@
+#ifndef LINEAR_ARENA_H
+#define LINEAR_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Default linear arena values
+const size_t ARENA_BLOCK_SIZE = (size_t) 4 << 20;
+const size_t ARENA_ALIGNMENT  = 16;
+
+
+// Scratch memory for asset import. Allocations bump a pointer through blocks that are kept until Release, so
+// freeing is a no-op and Reset drops everything allocated since in one step; once the blocks are large enough for
+// one asset, importing the next does not allocate from the system at all.
+//
+// An arena is made current for its thread with ArenaScope; ArenaMalloc / ArenaRealloc / ArenaFree (the STBI_MALLOC
+// hooks of libs/stb_image.cpp) serve from the current arena and fall back to malloc on threads without one. Whatever
+// is allocated from an arena must not be used after its Reset.
+class LinearArena
+{
+public:
+    unsigned int Allocations = 0;         // served from the blocks
+    unsigned int SystemAllocations = 0;   // blocks allocated with malloc
+    size_t PeakBytes = 0;                 // the most in use between two Resets
+
+    LinearArena() = default;
+    LinearArena(const LinearArena &) = delete;
+    LinearArena &operator=(const LinearArena &) = delete;
+
+    ~LinearArena()
+    {
+        Release();
+    }
+
+    // the arena of the calling thread, nullptr outside an ArenaScope
+    static LinearArena *&Current()
+    {
+        static thread_local LinearArena *current = nullptr;
+        return current;
+    }
+
+    void *Allocate(size_t size)
+    {
+        size = align(size);
+        while (active < blocks.size() && blocks[active].Used + size > blocks[active].Size)
+            active++;   // the rest of a block that cannot take this allocation stays unused until Reset
+        if (active == blocks.size()) {
+            Block block;
+            block.Size = std::max(ARENA_BLOCK_SIZE, size);
+            block.Data = (unsigned char *) std::malloc(block.Size);
+            if (!block.Data)
+                return nullptr;
+            blocks.push_back(block);
+            SystemAllocations++;
+        }
+        Block &block = blocks[active];
+        void *result = block.Data + block.Used;
+        block.Used += size;
+        inUse += size;
+        PeakBytes = std::max(PeakBytes, inUse);
+        Allocations++;
+        last = result;
+        return result;
+    }
+
+    // the last allocation grows in place while its block has room, anything else is copied
+    void *Reallocate(void *pointer, size_t oldSize, size_t newSize)
+    {
+        if (pointer && pointer == last) {
+            Block &block = blocks[active];
+            size_t offset = (unsigned char *) pointer - block.Data;
+            if (offset + align(newSize) <= block.Size) {
+                inUse += align(newSize) - (block.Used - offset);
+                block.Used = offset + align(newSize);
+                PeakBytes = std::max(PeakBytes, inUse);
+                return pointer;
+            }
+        }
+        void *result = Allocate(newSize);
+        if (result && pointer)
+            std::memcpy(result, pointer, std::min(oldSize, newSize));
+        return result;
+    }
+
+    // everything allocated so far is dropped, the blocks are kept for what follows
+    void Reset()
+    {
+        for (Block &block : blocks)
+            block.Used = 0;
+        active = 0;
+        inUse = 0;
+        last = nullptr;
+    }
+
+    // gives the blocks back to the system
+    void Release()
+    {
+        for (Block &block : blocks)
+            std::free(block.Data);
+        blocks.clear();
+        active = 0;
+        inUse = 0;
+        last = nullptr;
+    }
+
+    size_t Capacity() const
+    {
+        size_t total = 0;
+        for (const Block &block : blocks)
+            total += block.Size;
+        return total;
+    }
+
+private:
+    struct Block {
+        unsigned char *Data = nullptr;
+        size_t Size = 0;
+        size_t Used = 0;
+    };
+
+    std::vector<Block> blocks;
+    size_t active = 0;
+    size_t inUse = 0;
+    void *last = nullptr;
+
+    static size_t align(size_t size)
+    {
+        return (size + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1);
+    }
+};
+
+// makes an arena current on this thread for the scope's lifetime
+class ArenaScope
+{
+public:
+    explicit ArenaScope(LinearArena &arena) : previous(LinearArena::Current())
+    {
+        LinearArena::Current() = &arena;
+    }
+    ~ArenaScope()
+    {
+        LinearArena::Current() = previous;
+    }
+
+private:
+    LinearArena *previous;
+};
+
+
+// malloc-style hooks; every block starts with a header that says where it came from, so a pointer can be freed
+// correctly whatever arena is current at that point
+struct ArenaHeader {
+    size_t Size;
+    size_t FromArena;   // keeps the data ARENA_ALIGNMENT aligned
+};
+
+inline void *ArenaMalloc(size_t size)
+{
+    LinearArena *arena = LinearArena::Current();
+    ArenaHeader *header = (ArenaHeader *) (arena ? arena->Allocate(size + sizeof(ArenaHeader))
+                                                 : std::malloc(size + sizeof(ArenaHeader)));
+    if (!header)
+        return nullptr;
+    header->Size = size;
+    header->FromArena = arena != nullptr;
+    return header + 1;
+}
+
+inline void ArenaFree(void *pointer)
+{
+    if (!pointer)
+        return;
+    ArenaHeader *header = (ArenaHeader *) pointer - 1;
+    if (!header->FromArena)
+        std::free(header);
+}
+
+inline void *ArenaRealloc(void *pointer, size_t newSize)
+{
+    if (!pointer)
+        return ArenaMalloc(newSize);
+    ArenaHeader *header = (ArenaHeader *) pointer - 1;
+    LinearArena *arena = LinearArena::Current();
+    if (header->FromArena && arena) {
+        header = (ArenaHeader *) arena->Reallocate(header, header->Size + sizeof(ArenaHeader),
+                                                   newSize + sizeof(ArenaHeader));
+    } else if (!header->FromArena) {
+        header = (ArenaHeader *) std::realloc(header, newSize + sizeof(ArenaHeader));
+    } else {
+        // from an arena that is no longer current: move to the heap
+        void *moved = ArenaMalloc(newSize);
+        if (moved)
+            std::memcpy(moved, pointer, std::min(header->Size, newSize));
+        return moved;
+    }
+    if (!header)
+        return nullptr;
+    header->Size = newSize;
+    return header + 1;
+}
+#endif
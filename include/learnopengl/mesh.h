@@ -7,8 +7,14 @@
 #include <glm/gtc/matrix_transform.hpp>
 
 #include <learnopengl/shader.h>
+#include <learnopengl/render_stats.h>
+#include <learnopengl/resource_registry.h>
+#include <learnopengl/shader_variants.h>
 
+#include <algorithm>
+#include <cmath>
 #include <string>
+#include <utility>
 #include <vector>
 using namespace std;
 
@@ -27,10 +33,40 @@ struct Vertex {
 
 
 
+// how a material uses the alpha of its diffuse texture; decides the pass a mesh is drawn in
+enum Material_Alpha {
+    ALPHA_OPAQUE  = 1 << 0,   // alpha ignored: no discard, no blending
+    ALPHA_MASKED  = 1 << 1,   // texels are solid or cut out: alpha tested, writes depth, no blending
+    ALPHA_BLENDED = 1 << 2    // partly transparent: blended back to front after everything solid
+};
+const unsigned int ALPHA_ALL = ALPHA_OPAQUE | ALPHA_MASKED | ALPHA_BLENDED;
+
+
 struct Texture {
     unsigned int id;
     string type;
     string path;
+    Material_Alpha alpha = ALPHA_OPAQUE;   // what the image's alpha channel needs, see TextureFromFile
+};
+
+// a mesh whose vertices and indices are already in GL buffers it does not own (see GltfLoader); the attributes
+// use the locations of Vertex, in whatever format and stride the buffers have them
+struct MeshLayout {
+    struct Attribute {
+        unsigned int Buffer = 0;   // 0 if the mesh does not have the attribute
+        GLint Size = 0;
+        GLenum Type = GL_FLOAT;
+        GLboolean Normalized = GL_FALSE;
+        GLsizei Stride = 0;
+        size_t Offset = 0;
+    };
+    Attribute Attributes[5];   // position, normal, texture coordinates, tangent, bitangent
+    unsigned int IndexBuffer = 0;
+    GLenum IndexType = GL_UNSIGNED_INT;
+    size_t IndexOffset = 0;
+    unsigned int IndexCount = 0;
+    glm::vec3 Low = glm::vec3(0.0f), High = glm::vec3(0.0f);   // bounding box
+    float UVDensity = 0.0f;
 };
 
 class Mesh {
@@ -40,21 +76,166 @@ public:
     vector<unsigned int> indices;
     vector<Texture>      textures;
 
-    unsigned int VAO;
+    unsigned int VAO = 0;
+    // the same triangles with only the attributes depth passes read: position (location 0), plus texture
+    // coordinates (location 2) when the material is alpha tested
+    unsigned int DepthVAO = 0;
     std::string glslIdentifierPrefix;
-    // constructor
-    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures)
+    // what Draw draws; set by setupMesh, or taken from a MeshLayout
+    unsigned int IndexCount = 0;
+    GLenum IndexType = GL_UNSIGNED_INT;
+    size_t IndexOffset = 0;
+    // material features (Shader_Feature) the mesh's programs are specialized for
+    unsigned int Features = 0;
+    Material_Alpha Alpha = ALPHA_OPAQUE;
+    glm::vec3 Center = glm::vec3(0.0f);   // of the bounding box, orders blended meshes back to front
+    float Radius = 0.0f;                  // of the sphere around the bounding box
+    float UVDensity = 0.0f;               // texture coordinate units per model space unit, for texture streaming
+    // empty, for importers that fill meshes in place
+    Mesh() = default;
+    // constructor; declaredAlpha is what the material asks for (glTF alphaMode), the diffuse texture can only
+    // lower it: a BLEND material whose texture is only cut out is drawn masked. Without upload no GL call is
+    // made, so the mesh can be built on any thread and Upload called on the GL thread later.
+    Mesh(vector<Vertex> vertices, vector<unsigned int> indices, vector<Texture> textures,
+         Material_Alpha declaredAlpha = ALPHA_MASKED, bool upload = true)
     {
-        this->vertices = vertices;
-        this->indices = indices;
-        this->textures = textures;
+        // moved, the importer does not keep its copies
+        this->vertices = std::move(vertices);
+        this->indices = std::move(indices);
+        this->textures = std::move(textures);
+        classify(declaredAlpha);
+        if (!this->vertices.empty()) {
+            glm::vec3 low = this->vertices[0].Position, high = this->vertices[0].Position;
+            for (const Vertex &vertex : this->vertices) {
+                low = glm::min(low, vertex.Position);
+                high = glm::max(high, vertex.Position);
+            }
+            Center = (low + high) * 0.5f;
+            Radius = glm::length(high - low) * 0.5f;
+        }
+        // the ratio of the triangles' areas in texture and in model space
+        double uvArea = 0.0, area = 0.0;
+        for (size_t i = 0; i + 2 < this->indices.size(); i += 3) {
+            const Vertex &a = this->vertices[this->indices[i]];
+            const Vertex &b = this->vertices[this->indices[i + 1]];
+            const Vertex &c = this->vertices[this->indices[i + 2]];
+            glm::vec2 uv0 = b.TexCoords - a.TexCoords, uv1 = c.TexCoords - a.TexCoords;
+            uvArea += std::abs(uv0.x * uv1.y - uv0.y * uv1.x) * 0.5;
+            area += glm::length(glm::cross(b.Position - a.Position, c.Position - a.Position)) * 0.5;
+        }
+        if (area > 0.0)
+            UVDensity = (float) std::sqrt(uvArea / area);
 
         // now that we have all the required data, set the vertex buffers and its attribute pointers.
-        setupMesh();
+        if (upload)
+            setupMesh();
+    }
+
+    // a mesh drawn from buffers set up by a loader; only the vertex arrays are created, the mesh keeps no CPU copy
+    Mesh(const MeshLayout &layout, vector<Texture> textures, Material_Alpha declaredAlpha)
+    {
+        this->textures = std::move(textures);
+        classify(declaredAlpha);
+        Center = (layout.Low + layout.High) * 0.5f;
+        Radius = glm::length(layout.High - layout.Low) * 0.5f;
+        UVDensity = layout.UVDensity;
+        IndexCount = layout.IndexCount;
+        IndexType = layout.IndexType;
+        IndexOffset = layout.IndexOffset;
+
+        glGenVertexArrays(1, &VAO);
+        glBindVertexArray(VAO);
+        for (GLuint location = 0; location < 5; location++)
+            setupAttribute(location, layout.Attributes[location]);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, layout.IndexBuffer);
+
+        // the positions are read where they are: a loader's layout keeps them in their own packed array already
+        glGenVertexArrays(1, &DepthVAO);
+        glBindVertexArray(DepthVAO);
+        setupAttribute(0, layout.Attributes[0]);
+        if (Features & FEATURE_ALPHA_TEST)
+            setupAttribute(2, layout.Attributes[2]);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, layout.IndexBuffer);
+        glBindVertexArray(0);
+    }
+
+    // creates the GL buffers of a mesh constructed without upload
+    void Upload()
+    {
+        if (VAO == 0)
+            setupMesh();
     }
 
     // render the mesh
     void Draw(Shader &shader)
+    {
+        bindTextures(shader);
+
+        // draw mesh
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, IndexCount, IndexType, (void*)IndexOffset);
+        RenderStats::Get().AddDraw(IndexCount);
+        glBindVertexArray(0);
+
+        // always good practice to set everything back to defaults once configured.
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // render the mesh from the depth stream; textures are only bound when the alpha test needs them
+    void DrawDepth(Shader &shader)
+    {
+        if (Features & FEATURE_ALPHA_TEST)
+            bindTextures(shader);
+
+        glBindVertexArray(DepthVAO);
+        glDrawElements(GL_TRIANGLES, IndexCount, IndexType, (void*)IndexOffset);
+        RenderStats::Get().AddDraw(IndexCount);
+        glBindVertexArray(0);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    // reports the mesh's buffers to the ResourceRegistry under the given owner; the buffers of a MeshLayout are
+    // reported by their loader
+    void TrackResources(const string &owner) const
+    {
+        if (VBO == 0)
+            return;
+        ResourceRegistry &registry = ResourceRegistry::Get();
+        size_t depthVertex = sizeof(glm::vec3) + (Features & FEATURE_ALPHA_TEST ? sizeof(glm::vec2) : 0);
+        registry.Track(RESOURCE_BUFFER, VBO, vertices.size() * sizeof(Vertex), owner + " vertices");
+        registry.Track(RESOURCE_BUFFER, EBO, indices.size() * sizeof(unsigned int), owner + " indices");
+        registry.Track(RESOURCE_BUFFER, depthVBO, vertices.size() * depthVertex, owner + " depth stream");
+    }
+
+private:
+    // render data
+    unsigned int VBO = 0, EBO = 0, depthVBO = 0;
+
+    void classify(Material_Alpha declaredAlpha)
+    {
+        Material_Alpha textureAlpha = ALPHA_OPAQUE;
+        for (const Texture &texture : textures)
+            if (texture.type == "texture_diffuse")
+                textureAlpha = std::max(textureAlpha, texture.alpha);
+        Alpha = std::min(declaredAlpha, textureAlpha);
+        if (Alpha != ALPHA_OPAQUE)
+            Features |= FEATURE_ALPHA_TEST;   // blended meshes cast alpha tested shadows
+        if (Alpha == ALPHA_BLENDED)
+            Features |= FEATURE_ALPHA_BLEND;
+    }
+
+    // points a location of the bound vertex array at a MeshLayout attribute; missing ones keep the default value
+    static void setupAttribute(GLuint location, const MeshLayout::Attribute &attribute)
+    {
+        if (attribute.Buffer == 0)
+            return;
+        glBindBuffer(GL_ARRAY_BUFFER, attribute.Buffer);
+        glEnableVertexAttribArray(location);
+        glVertexAttribPointer(location, attribute.Size, attribute.Type, attribute.Normalized, attribute.Stride,
+                              (void*)attribute.Offset);
+    }
+
+    void bindTextures(Shader &shader)
     {
         // bind appropriate textures
         unsigned int diffuseNr  = 1;
@@ -81,22 +262,8 @@ public:
             // and finally bind the texture
             glBindTexture(GL_TEXTURE_2D, textures[i].id);
         }
-
-
-
-        // draw mesh
-        glBindVertexArray(VAO);
-        glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
-
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
     }
 
-private:
-    // render data
-    unsigned int VBO, EBO;
-
     // initializes all the buffer objects/arrays
     void setupMesh()
     {
@@ -115,6 +282,7 @@ private:
 
         glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        IndexCount = (unsigned int) indices.size();
 
         // set the vertex attribute pointers
         // vertex Positions
@@ -134,6 +302,45 @@ private:
         glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
 
         glBindVertexArray(0);
+
+        setupDepthStream();
+    }
+
+    // a second, tightly packed vertex buffer for depth passes: 12 bytes per vertex instead of sizeof(Vertex), 20
+    // for alpha tested materials. It shares the element buffer with VAO.
+    void setupDepthStream()
+    {
+        bool texCoords = Features & FEATURE_ALPHA_TEST;
+        vector<glm::vec3> positions(vertices.size());
+        vector<glm::vec2> uvs(texCoords ? vertices.size() : 0);
+        for (size_t i = 0; i < vertices.size(); i++)
+            positions[i] = vertices[i].Position;
+        for (size_t i = 0; i < uvs.size(); i++)
+            uvs[i] = vertices[i].TexCoords;
+        size_t positionBytes = positions.size() * sizeof(glm::vec3);
+        size_t uvBytes = uvs.size() * sizeof(glm::vec2);
+
+        glGenVertexArrays(1, &DepthVAO);
+        glGenBuffers(1, &depthVBO);
+
+        glBindVertexArray(DepthVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, depthVBO);
+        // positions first, then the texture coordinates, each array packed
+        glBufferData(GL_ARRAY_BUFFER, positionBytes + uvBytes, nullptr, GL_STATIC_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, positionBytes, positions.data());
+        if (texCoords)
+            glBufferSubData(GL_ARRAY_BUFFER, positionBytes, uvBytes, uvs.data());
+
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), (void*)0);
+        if (texCoords) {
+            glEnableVertexAttribArray(2);
+            glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(glm::vec2), (void*)positionBytes);
+        }
+
+        glBindVertexArray(0);
     }
 };
 #endif
\ No newline at end of file
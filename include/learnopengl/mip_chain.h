@@ -0,0 +1,257 @@
+#ifndef MIP_CHAIN_H
+#define MIP_CHAIN_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/content_hash.h>
+#include <learnopengl/thread_pool.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MIP_CHAIN_SSE
+#endif
+
+// Default mip chain values
+const unsigned int MIPMAP_CACHE_VERSION  = 1;   // bump when the filter changes, old cache files are then ignored
+const char *const MIPMAP_CACHE_DIRECTORY = "resources/cache/";
+const unsigned int MIPMAP_ROWS_PER_TASK  = 16;  // output rows per ParallelFor index
+
+
+// The mip levels of an 8 bit image, built on the CPU instead of with glGenerateMipmap. Each level is a 2x2 box
+// filter of the one above it; for sRGB images the color channels are averaged in linear space, so dark and
+// bright texels do not blend to a too dark mip, alpha always stays linear. The rows of a level are split across the
+// ThreadPool, and the vertical half of the filter sums eight bytes at a time with SSE2.
+//
+// Generate stores the result in MIPMAP_CACHE_DIRECTORY under a ContentHash of the source file's contents and the
+// filter parameters, so every later run (and the TextureStreamer's reloads) reads the levels instead.
+class MipChain
+{
+public:
+    int Width = 0, Height = 0, Components = 0;
+    bool SRGB = false;
+    bool FromCache = false;
+    std::vector<std::vector<unsigned char>> Levels;   // Levels[i] is mip level i + 1, level 0 is the image itself
+
+    // number of levels including level 0
+    int Count() const
+    {
+        return (int) Levels.size() + 1;
+    }
+    static int LevelCount(int width, int height)
+    {
+        return 1 + (int) std::floor(std::log2((float) std::max(width, height)));
+    }
+    static int LevelWidth(int width, int level)
+    {
+        return std::max(width >> level, 1);
+    }
+
+    // the chain of the image decoded from path into data: from the cache, or built on the ThreadPool and stored
+    bool Generate(const std::string &path, const unsigned char *data, int width, int height, int components, bool srgb)
+    {
+        if (Load(path, width, height, components, srgb))
+            return true;
+        Build(data, width, height, components, srgb, true);
+        Store(path);
+        return true;
+    }
+
+    // reads the chain from the cache only; false if it is not there
+    bool Load(const std::string &path, int width, int height, int components, bool srgb)
+    {
+        reset(width, height, components, srgb);
+        uint64_t hash;
+        if (!key(path, hash))
+            return false;
+        std::ifstream in(cachePath(hash), std::ios::binary);
+        if (!in)
+            return false;
+        unsigned int version = 0;
+        in.read((char *) &version, sizeof(version));
+        if (!in || version != MIPMAP_CACHE_VERSION)
+            return false;
+        for (int level = 1; level < LevelCount(Width, Height); level++) {
+            Levels.emplace_back(levelBytes(level));
+            in.read((char *) Levels.back().data(), Levels.back().size());
+        }
+        if (!in) {
+            std::cout << "ERROR::MIP_CHAIN:: Cache file is truncated, building again: " << cachePath(hash) << std::endl;
+            Levels.clear();
+            return false;
+        }
+        FromCache = true;
+        return true;
+    }
+
+    // filters the levels from the image; parallel spreads each level's rows across the ThreadPool
+    void Build(const unsigned char *data, int width, int height, int components, bool srgb, bool parallel)
+    {
+        reset(width, height, components, srgb);
+        const unsigned char *source = data;
+        for (int level = 1; level < LevelCount(Width, Height); level++) {
+            Levels.emplace_back(levelBytes(level));
+            unsigned char *target = Levels.back().data();
+            int rows = LevelWidth(Height, level);
+            unsigned int tasks = (unsigned int) (rows + MIPMAP_ROWS_PER_TASK - 1) / MIPMAP_ROWS_PER_TASK;
+            auto task = [&](unsigned int i) {
+                int first = (int) (i * MIPMAP_ROWS_PER_TASK);
+                downsample(source, target, level, first, std::min(first + (int) MIPMAP_ROWS_PER_TASK, rows));
+            };
+            if (parallel)
+                ThreadPool::Get().ParallelFor(tasks, task);
+            else
+                for (unsigned int i = 0; i < tasks; i++)
+                    task(i);
+            source = target;
+        }
+    }
+
+    void Store(const std::string &path) const
+    {
+        uint64_t hash;
+        if (!key(path, hash))
+            return;
+        std::ofstream out(cachePath(hash), std::ios::binary);
+        out.write((const char *) &MIPMAP_CACHE_VERSION, sizeof(MIPMAP_CACHE_VERSION));
+        for (const std::vector<unsigned char> &level : Levels)
+            out.write((const char *) level.data(), level.size());
+        if (!out)
+            std::cout << "ERROR::MIP_CHAIN:: Failed to write cache file: " << cachePath(hash) << std::endl;
+    }
+
+    // level 0 is the image the chain was built from
+    const unsigned char *Level(const unsigned char *image, int level) const
+    {
+        return level == 0 ? image : Levels[level - 1].data();
+    }
+
+    // uploads levels [first, Count()) into the bound GL_TEXTURE_2D, one glTexImage2D per level
+    void Upload(const unsigned char *image, GLint internalFormat, GLenum format, int first = 0) const
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (int level = first; level < Count(); level++)
+            glTexImage2D(GL_TEXTURE_2D, level, internalFormat, LevelWidth(Width, level), LevelWidth(Height, level), 0,
+                         format, GL_UNSIGNED_BYTE, Level(image, level));
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, Count() - 1);
+    }
+
+private:
+    void reset(int width, int height, int components, bool srgb)
+    {
+        Width = width;
+        Height = height;
+        Components = components;
+        SRGB = srgb;
+        FromCache = false;
+        Levels.clear();
+    }
+
+    size_t levelBytes(int level) const
+    {
+        return (size_t) LevelWidth(Width, level) * LevelWidth(Height, level) * Components;
+    }
+
+    bool key(const std::string &path, uint64_t &hash) const
+    {
+        const int parameters[] = {(int) MIPMAP_CACHE_VERSION, Width, Height, Components, SRGB};
+        hash = ContentHash(parameters, sizeof(parameters));
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            return false;
+        std::vector<char> buffer(1 << 16);
+        while (in.read(buffer.data(), buffer.size()) || in.gcount() > 0)
+            hash = ContentHash(buffer.data(), (size_t) in.gcount(), hash);
+        return true;
+    }
+
+    static std::string cachePath(uint64_t hash)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "mips_%016llx.bin", (unsigned long long) hash);
+        return std::string(MIPMAP_CACHE_DIRECTORY) + name;
+    }
+
+    // 8 bit sRGB to linear, and linear quantized to 12 bits back to sRGB
+    static const float *toLinear()
+    {
+        static std::vector<float> table = [] {
+            std::vector<float> t(256);
+            for (int i = 0; i < 256; i++) {
+                float c = i / 255.0f;
+                t[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+            }
+            return t;
+        }();
+        return table.data();
+    }
+    static const unsigned char *toSRGB()
+    {
+        static std::vector<unsigned char> table = [] {
+            std::vector<unsigned char> t(4096);
+            for (int i = 0; i < 4096; i++) {
+                float c = i / 4095.0f;
+                c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+                t[i] = (unsigned char) std::lround(std::min(std::max(c, 0.0f), 1.0f) * 255.0f);
+            }
+            return t;
+        }();
+        return table.data();
+    }
+
+    // rows [firstRow, lastRow) of a level from the level above it
+    void downsample(const unsigned char *source, unsigned char *target, int level, int firstRow, int lastRow) const
+    {
+        int sourceWidth = LevelWidth(Width, level - 1), sourceHeight = LevelWidth(Height, level - 1);
+        int width = LevelWidth(Width, level);
+        int c = Components;
+        size_t sourceRow = (size_t) sourceWidth * c;
+        bool linearize = SRGB && c >= 3;
+        const float *linear = toLinear();
+        const unsigned char *encode = toSRGB();
+        std::vector<unsigned short> sums(sourceRow);   // the two source rows added, per byte
+        std::vector<float> linearSums(linearize ? sourceRow : 0);
+
+        for (int y = firstRow; y < lastRow; y++) {
+            const unsigned char *row0 = source + std::min(2 * y, sourceHeight - 1) * sourceRow;
+            const unsigned char *row1 = source + std::min(2 * y + 1, sourceHeight - 1) * sourceRow;
+            if (linearize) {
+                for (size_t i = 0; i < sourceRow; i++)
+                    linearSums[i] = linear[row0[i]] + linear[row1[i]];
+            }
+            size_t i = 0;
+#ifdef MIP_CHAIN_SSE
+            const __m128i zero = _mm_setzero_si128();
+            for (; i + 8 <= sourceRow; i += 8) {
+                __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (row0 + i)), zero);
+                __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) (row1 + i)), zero);
+                _mm_storeu_si128((__m128i *) (sums.data() + i), _mm_add_epi16(a, b));
+            }
+#endif
+            for (; i < sourceRow; i++)
+                sums[i] = (unsigned short) (row0[i] + row1[i]);
+
+            unsigned char *out = target + (size_t) y * width * c;
+            for (int x = 0; x < width; x++) {
+                size_t x0 = (size_t) std::min(2 * x, sourceWidth - 1) * c;
+                size_t x1 = (size_t) std::min(2 * x + 1, sourceWidth - 1) * c;
+                for (int k = 0; k < c; k++) {
+                    if (linearize && k < 3) {
+                        float value = (linearSums[x0 + k] + linearSums[x1 + k]) * 0.25f;
+                        out[x * c + k] = encode[(int) (value * 4095.0f + 0.5f)];
+                    } else
+                        out[x * c + k] = (unsigned char) ((sums[x0 + k] + sums[x1 + k] + 2) >> 2);
+                }
+            }
+        }
+    }
+};
+#endif
@@ -10,18 +10,40 @@
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+// glTF material key, from assimp's glTF material header that scene.h does not include
+#ifndef AI_MATKEY_GLTF_ALPHAMODE
+#define AI_MATKEY_GLTF_ALPHAMODE "$mat.gltf.alphaMode", 0, 0
+#endif
+
+#include <learnopengl/gltf_loader.h>
+#include <learnopengl/linear_arena.h>
 #include <learnopengl/mesh.h>
+#include <learnopengl/mip_chain.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/texture_streamer.h>
+#include <learnopengl/thread_pool.h>
 
+#include <cstddef>
 #include <string>
 #include <fstream>
 #include <sstream>
 #include <iostream>
 #include <map>
+#include <thread>
+#include <utility>
 #include <vector>
 using namespace std;
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false);
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MODEL_SSE
+#endif
+
+// Default texture analysis values
+const unsigned char ALPHA_CUTOUT_THRESHOLD = 102;   // 0.4, the threshold of the ALPHA_TEST variants
+const float ALPHA_BLEND_SHARE             = 0.25f;  // partly transparent share of the non-solid texels that needs blending
+
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma = false, Material_Alpha *alpha = nullptr);
 
 
 
@@ -33,11 +55,79 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    // scratch allocations of the import (image decoding) served by its LinearArena, and how many of them needed a
+    // new block from the system; the difference is what the arena saved
+    unsigned int ImportAllocations = 0;
+    unsigned int ImportSystemAllocations = 0;
+    size_t ImportPeakBytes = 0;
+
+    // empty, for LoadAll
+    Model() : gammaCorrection(false) {}
 
     // constructor, expects a filepath to a 3D model.
     Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
     {
-        loadModel(path);
+        LoadAll({{this, path}});
+    }
+
+    // loads several models at once. The files are read on a thread each, glTF by the GltfLoader and everything
+    // else by Assimp; then the textures are loaded on the calling thread. glTF meshes are drawn from the loader's
+    // buffers right away, the vertices and indices of every Assimp mesh of every model are converted across the
+    // ThreadPool and their GL buffers created in one go at the end. The calling thread needs the GL context.
+    static void LoadAll(const vector<pair<Model *, string>> &models)
+    {
+        vector<GltfLoader> gltfs(models.size());
+        vector<char> native(models.size(), 0);
+        vector<Assimp::Importer> importers(models.size());
+        vector<const aiScene *> scenes(models.size());
+        auto read = [&](size_t i) {
+            native[i] = gltfs[i].Parse(models[i].second);
+            if (!native[i])
+                scenes[i] = importers[i].ReadFile(models[i].second, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
+        };
+        vector<std::thread> readers;
+        for (size_t i = 1; i < models.size(); i++)
+            readers.emplace_back(read, i);
+        if (!models.empty())
+            read(0);
+        for (std::thread &reader : readers)
+            reader.join();
+
+        vector<MeshJob> jobs;
+        for (size_t i = 0; i < models.size(); i++)
+        {
+            if (native[i])
+            {
+                models[i].first->prepareGltf(models[i].second, gltfs[i]);
+                continue;
+            }
+            const aiScene *scene = scenes[i];
+            // check for errors
+            if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
+            {
+                cout << "ERROR::ASSIMP:: " << importers[i].GetErrorString() << endl;
+                continue;
+            }
+            models[i].first->prepare(models[i].second, scene, jobs);
+        }
+
+        ThreadPool::Get().ParallelFor((unsigned int) jobs.size(), [&jobs](unsigned int i) {
+            MeshJob &job = jobs[i];
+            vector<Vertex> vertices(job.Source->mNumVertices);
+            vector<unsigned int> indices;
+            indices.reserve((size_t) job.Source->mNumFaces * 3);   // triangulated on import
+            convertVertices(job.Source, vertices.data());
+            for (unsigned int f = 0; f < job.Source->mNumFaces; f++)
+            {
+                const aiFace &face = job.Source->mFaces[f];
+                indices.insert(indices.end(), face.mIndices, face.mIndices + face.mNumIndices);
+            }
+            job.Owner->meshes[job.Index] = Mesh(std::move(vertices), std::move(indices), std::move(job.Textures),
+                                                job.DeclaredAlpha, false);
+        });
+
+        for (const pair<Model *, string> &loaded : models)
+            loaded.first->upload(loaded.second);
     }
 
     // draws the model, and thus all its meshes
@@ -47,122 +137,218 @@ public:
             meshes[i].Draw(shader);
     }
 
+    // draws every mesh of the given alpha classes (Material_Alpha bits) with the variant for its material; meshes
+    // whose variant is still compiling are skipped
+    void Draw(ShaderVariants &variants, unsigned int alphaClasses = ALPHA_ALL)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            if (!(meshes[i].Alpha & alphaClasses))
+                continue;
+            Shader *shader = variants.Get(meshes[i].Features);
+            if (!shader)
+                continue;
+            shader->use();
+            meshes[i].Draw(*shader);
+        }
+    }
+
+    // the same from the meshes' depth streams, for passes that only need depth (and the alpha test)
+    void DrawDepth(ShaderVariants &variants, unsigned int alphaClasses = ALPHA_ALL)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            if (!(meshes[i].Alpha & alphaClasses))
+                continue;
+            Shader *shader = variants.Get(meshes[i].Features);
+            if (!shader)
+                continue;
+            shader->use();
+            meshes[i].DrawDepth(*shader);
+        }
+    }
+
+    // tells the TextureStreamer which mips the model's textures need when drawn with the given model matrix
+    void RequestMips(const glm::mat4 &model)
+    {
+        TextureStreamer &streamer = TextureStreamer::Get();
+        float scale = glm::length(glm::vec3(model[0]));   // the scenes' model matrices scale uniformly
+        for (const Mesh &mesh : meshes)
+        {
+            glm::vec3 center = glm::vec3(model * glm::vec4(mesh.Center, 1.0f));
+            for (const Texture &texture : mesh.textures)
+                streamer.Request(texture.id, center, mesh.Radius * scale, mesh.UVDensity / scale);
+        }
+    }
+
     void SetShaderTextureNamePrefix(std::string prefix) {
         for (Mesh& mesh: meshes) {
             mesh.glslIdentifierPrefix = prefix;
         }
     }
 private:
-    // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
-    void loadModel(string const &path)
+    // a mesh of LoadAll whose textures are loaded, converted on the ThreadPool into Owner->meshes[Index]
+    struct MeshJob {
+        Model *Owner;
+        unsigned int Index;
+        const aiMesh *Source;
+        vector<Texture> Textures;
+        Material_Alpha DeclaredAlpha;
+    };
+
+    // loads the textures of the scene's meshes and adds a MeshJob for each, in node order
+    void prepare(string const &path, const aiScene *scene, vector<MeshJob> &jobs)
     {
-        // read file via ASSIMP
-        Assimp::Importer importer;
-        const aiScene* scene = importer.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_FlipUVs | aiProcess_CalcTangentSpace);
-        // check for errors
-        if(!scene || scene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !scene->mRootNode) // if is Not Zero
-        {
-            cout << "ERROR::ASSIMP:: " << importer.GetErrorString() << endl;
-            return;
-        }
+        // scratch memory of the texture imports, reset after every texture and released at the end
+        LinearArena arena;
+        ArenaScope scope(arena);
+
         // retrieve the directory path of the filepath
         directory = path.substr(0, path.find_last_of('/'));
 
         // process ASSIMP's root node recursively
-        processNode(scene->mRootNode, scene);
+        vector<const aiMesh *> sources;
+        sources.reserve(scene->mNumMeshes);
+        processNode(scene->mRootNode, scene, sources);
+        meshes.resize(sources.size());
+        for (unsigned int i = 0; i < sources.size(); i++)
+        {
+            MeshJob job{this, i, sources[i], {}, ALPHA_MASKED};
+            processMaterial(scene->mMaterials[sources[i]->mMaterialIndex], job);
+            jobs.push_back(std::move(job));
+        }
+        recordImport(path, arena);
     }
 
-    // processes a node in a recursive fashion. Processes each individual mesh located at the node and repeats this process on its children nodes (if any).
-    void processNode(aiNode *node, const aiScene *scene)
+    // loads the textures of a file parsed by the GltfLoader and creates its meshes on the loader's buffers
+    void prepareGltf(string const &path, GltfLoader &gltf)
+    {
+        LinearArena arena;
+        ArenaScope scope(arena);
+        directory = path.substr(0, path.find_last_of('/'));
+
+        gltf.Upload(path);
+        meshes.reserve(gltf.Primitives.size());
+        for (const GltfLoader::Primitive &primitive : gltf.Primitives)
+        {
+            vector<Texture> textures;
+            Material_Alpha declaredAlpha = ALPHA_MASKED;   // as Assimp's default material
+            if (primitive.Material >= 0 && primitive.Material < (int) gltf.Materials.size())
+            {
+                const GltfLoader::Material &material = gltf.Materials[primitive.Material];
+                declaredAlpha = material.Alpha;
+                if (!material.BaseColor.empty())
+                    textures.push_back(loadTexture(material.BaseColor.c_str(), "texture_diffuse"));
+            }
+            meshes.emplace_back(primitive.Layout, std::move(textures), declaredAlpha);
+        }
+        recordImport(path, arena);
+    }
+
+    void recordImport(string const &path, const LinearArena &arena)
+    {
+        ImportAllocations = arena.Allocations;
+        ImportSystemAllocations = arena.SystemAllocations;
+        ImportPeakBytes = arena.PeakBytes;
+        ResourceRegistry::Get().AddImport({path, ImportAllocations, ImportSystemAllocations, ImportPeakBytes});
+    }
+
+    // creates the GL buffers of the converted meshes
+    void upload(string const &path)
+    {
+        // the meshes keep their vertices and indices after the upload
+        size_t cpuBytes = 0;
+        for(unsigned int i = 0; i < meshes.size(); i++)
+        {
+            meshes[i].Upload();
+            meshes[i].TrackResources(path + " mesh " + std::to_string(i));
+            cpuBytes += meshes[i].vertices.size() * sizeof(Vertex) + meshes[i].indices.size() * sizeof(unsigned int);
+        }
+        if (cpuBytes > 0)   // glTF meshes keep nothing
+            ResourceRegistry::Get().Track(RESOURCE_CPU, (uintptr_t) this, cpuBytes, path + " vertices and indices");
+    }
+
+    // collects the meshes of a node and, recursively, of its children
+    void processNode(const aiNode *node, const aiScene *scene, vector<const aiMesh *> &sources)
     {
         // process each mesh located at the current node
         for(unsigned int i = 0; i < node->mNumMeshes; i++)
         {
             // the node object only contains indices to index the actual objects in the scene.
             // the scene contains all the data, node is just to keep stuff organized (like relations between nodes).
-            aiMesh* mesh = scene->mMeshes[node->mMeshes[i]];
-            meshes.push_back(processMesh(mesh, scene));
+            sources.push_back(scene->mMeshes[node->mMeshes[i]]);
         }
         // after we've processed all of the meshes (if any) we then recursively process each of the children nodes
         for(unsigned int i = 0; i < node->mNumChildren; i++)
         {
-            processNode(node->mChildren[i], scene);
+            processNode(node->mChildren[i], scene, sources);
         }
 
     }
 
-    Mesh processMesh(aiMesh *mesh, const aiScene *scene)
+    // interleaves the mesh's attribute arrays into vertices, which has room for all of them. With SSE every
+    // attribute is moved as four floats; the fourth lands in the next attribute, which is written after it, so
+    // only the last vertex (whose spill would leave the array, and whose source reads would too) is copied per float.
+    static void convertVertices(const aiMesh *mesh, Vertex *vertices)
     {
-        // data to fill
-        vector<Vertex> vertices;
-        vector<unsigned int> indices;
-        vector<Texture> textures;
-
-        // walk through each of the mesh's vertices
-        for(unsigned int i = 0; i < mesh->mNumVertices; i++)
+        unsigned int count = mesh->mNumVertices;
+        const aiVector3D *normals = mesh->HasNormals() ? mesh->mNormals : nullptr;
+        const aiVector3D *texCoords = mesh->mTextureCoords[0];   // we always take the first of the up to 8 sets
+        bool tangents = texCoords && mesh->HasTangentsAndBitangents();
+        unsigned int i = 0;
+#ifdef MODEL_SSE
+        static_assert(sizeof(aiVector3D) == 3 * sizeof(float), "aiVector3D is read as three floats");
+        static_assert(offsetof(Vertex, Normal) == 12 && offsetof(Vertex, TexCoords) == 24 &&
+                      offsetof(Vertex, Tangent) == 32 && offsetof(Vertex, Bitangent) == 44 && sizeof(Vertex) == 56,
+                      "the stores below spill into the following attribute");
+        const __m128 zero = _mm_setzero_ps();
+        for (; i + 1 < count; i++)
         {
-            Vertex vertex;
-            glm::vec3 vector; // we declare a placeholder vector since assimp_ uses its own vector class that doesn't directly convert to glm's vec3 class so we transfer the data to this placeholder glm::vec3 first.
-            // positions
-            vector.x = mesh->mVertices[i].x;
-            vector.y = mesh->mVertices[i].y;
-            vector.z = mesh->mVertices[i].z;
-            vertex.Position = vector;
-            // normals
-            if (mesh->HasNormals())
-            {
-                vector.x = mesh->mNormals[i].x;
-                vector.y = mesh->mNormals[i].y;
-                vector.z = mesh->mNormals[i].z;
-                vertex.Normal = vector;
-            }
-            // texture coordinates
-            if(mesh->mTextureCoords[0]) // does the mesh contain texture coordinates?
-            {
-                glm::vec2 vec;
-                // a vertex can contain up to 8 different texture coordinates. We thus make the assumption that we won't
-                // use models where a vertex can have multiple texture coordinates so we always take the first set (0).
-                vec.x = mesh->mTextureCoords[0][i].x;
-                vec.y = mesh->mTextureCoords[0][i].y;
-                vertex.TexCoords = vec;
-                // tangent
-                vector.x = mesh->mTangents[i].x;
-                vector.y = mesh->mTangents[i].y;
-                vector.z = mesh->mTangents[i].z;
-                vertex.Tangent = vector;
-                // bitangent
-                vector.x = mesh->mBitangents[i].x;
-                vector.y = mesh->mBitangents[i].y;
-                vector.z = mesh->mBitangents[i].z;
-                vertex.Bitangent = vector;
-            }
-            else
-                vertex.TexCoords = glm::vec2(0.0f, 0.0f);
-
-            vertices.push_back(vertex);
-
-
+            float *out = (float *) &vertices[i];
+            _mm_storeu_ps(out, _mm_loadu_ps(&mesh->mVertices[i].x));
+            _mm_storeu_ps(out + 3, normals ? _mm_loadu_ps(&normals[i].x) : zero);
+            _mm_storel_pi((__m64 *) (out + 6), texCoords ? _mm_loadu_ps(&texCoords[i].x) : zero);
+            _mm_storeu_ps(out + 8, tangents ? _mm_loadu_ps(&mesh->mTangents[i].x) : zero);
+            _mm_storeu_ps(out + 11, tangents ? _mm_loadu_ps(&mesh->mBitangents[i].x) : zero);
         }
-        // now wak through each of the mesh's faces (a face is a mesh its triangle) and retrieve the corresponding vertex indices.
-        for(unsigned int i = 0; i < mesh->mNumFaces; i++)
+#endif
+        for (; i < count; i++)
         {
-            aiFace face = mesh->mFaces[i];
-            // retrieve all indices of the face and store them in the indices vector
-            for(unsigned int j = 0; j < face.mNumIndices; j++)
-                indices.push_back(face.mIndices[j]);
+            Vertex &vertex = vertices[i];
+            const aiVector3D &position = mesh->mVertices[i];
+            vertex.Position = glm::vec3(position.x, position.y, position.z);
+            vertex.Normal = normals ? glm::vec3(normals[i].x, normals[i].y, normals[i].z) : glm::vec3(0.0f);
+            vertex.TexCoords = texCoords ? glm::vec2(texCoords[i].x, texCoords[i].y) : glm::vec2(0.0f);
+            vertex.Tangent = vertex.Bitangent = glm::vec3(0.0f);
+            if (tangents)
+            {
+                const aiVector3D &tangent = mesh->mTangents[i], &bitangent = mesh->mBitangents[i];
+                vertex.Tangent = glm::vec3(tangent.x, tangent.y, tangent.z);
+                vertex.Bitangent = glm::vec3(bitangent.x, bitangent.y, bitangent.z);
+            }
         }
-        // process materials
-        aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
+    }
+
+    // loads the material's textures into job.Textures and reads how it uses alpha
+    void processMaterial(aiMaterial *material, MeshJob &job)
+    {
         // we assume a convention for sampler names in the shaders. Each diffuse texture should be named
         // as 'texture_diffuseN' where N is a sequential number ranging from 1 to MAX_SAMPLER_NUMBER.
         // Same applies to other texture as the following list summarizes:
         // diffuse: texture_diffuseN
         // specular: texture_specularN
         // normal: texture_normalN
-        aiColor3D color(0.0f, 0.0f, 0.0f);
-        material->Get(AI_MATKEY_COLOR_AMBIENT, color);
-
+        // glTF declares how alpha is used; other formats keep the alpha test the shaders always had
+        aiString alphaMode;
+        if (material->Get(AI_MATKEY_GLTF_ALPHAMODE, alphaMode) == AI_SUCCESS)
+        {
+            if (std::strcmp(alphaMode.C_Str(), "OPAQUE") == 0)
+                job.DeclaredAlpha = ALPHA_OPAQUE;
+            else if (std::strcmp(alphaMode.C_Str(), "BLEND") == 0)
+                job.DeclaredAlpha = ALPHA_BLENDED;
+        }
 
+        vector<Texture> &textures = job.Textures;
         // 1. diffuse maps
         vector<Texture> diffuseMaps = loadMaterialTextures(material, aiTextureType_DIFFUSE, "texture_diffuse");
         textures.insert(textures.end(), diffuseMaps.begin(), diffuseMaps.end());
@@ -175,11 +361,6 @@ private:
         // 4. height maps
         std::vector<Texture> heightMaps = loadMaterialTextures(material, aiTextureType_AMBIENT, "texture_height");
         textures.insert(textures.end(), heightMaps.begin(), heightMaps.end());
-
-
-
-        // return a mesh object created from the extracted mesh data
-        return Mesh(vertices, indices, textures);
     }
 
     // checks all material textures of a given type and loads the textures if they're not loaded yet.
@@ -191,33 +372,35 @@ private:
         {
             aiString str;
             mat->GetTexture(type, i, &str);
-            // check if texture was loaded before and if so, continue to next iteration: skip loading a new texture
-            bool skip = false;
-            for(unsigned int j = 0; j < textures_loaded.size(); j++)
-            {
-                if(std::strcmp(textures_loaded[j].path.data(), str.C_Str()) == 0)
-                {
-                    textures.push_back(textures_loaded[j]);
-                    skip = true; // a texture with the same filepath has already been loaded, continue to next one. (optimization)
-                    break;
-                }
-            }
-            if(!skip)
-            {   // if texture hasn't been loaded already, load it
-                Texture texture;
-                texture.id = TextureFromFile(str.C_Str(), this->directory);
-                texture.type = typeName;
-                texture.path = str.C_Str();
-                textures.push_back(texture);
-                textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
-            }
+            textures.push_back(loadTexture(str.C_Str(), typeName));
         }
         return textures;
     }
+
+    // the texture at path (relative to the model's directory), loaded unless the model loaded it before
+    Texture loadTexture(const char *path, const string &typeName)
+    {
+        // check if texture was loaded before and if so, return it: skip loading a new texture
+        for(unsigned int j = 0; j < textures_loaded.size(); j++)
+        {
+            if(std::strcmp(textures_loaded[j].path.data(), path) == 0)
+                return textures_loaded[j]; // a texture with the same filepath has already been loaded (optimization)
+        }
+        // if texture hasn't been loaded already, load it
+        Texture texture;
+        texture.id = TextureFromFile(path, this->directory, false, &texture.alpha);
+        LinearArena::Current()->Reset();   // the image is uploaded, its decoding scratch can go
+        texture.type = typeName;
+        texture.path = path;
+        textures_loaded.push_back(texture);  // store it as texture loaded for entire model, to ensure we won't unnecesery load duplicate textures.
+        return texture;
+    }
 };
 
 
-unsigned int TextureFromFile(const char *path, const string &directory, bool gamma)
+// alpha (optional) receives what the image's alpha channel needs: ALPHA_OPAQUE without transparent texels,
+// ALPHA_BLENDED when a good share of them is partly transparent, ALPHA_MASKED for cut-outs
+unsigned int TextureFromFile(const char *path, const string &directory, bool gamma, Material_Alpha *alpha)
 {
     string filename = string(path);
     filename = directory + '/' + filename;
@@ -237,9 +420,37 @@ unsigned int TextureFromFile(const char *path, const string &directory, bool gam
         else if (nrComponents == 4)
             format = GL_RGBA;
 
+        if (alpha)
+        {
+            size_t cutout = 0, partial = 0, transparent = 0;
+            for (int i = 3; nrComponents == 4 && i < width * height * 4; i += 4)
+            {
+                if (data[i] >= 247)
+                    continue;
+                transparent++;
+                if (data[i] < ALPHA_CUTOUT_THRESHOLD)
+                    cutout++;
+                if (data[i] > 8)
+                    partial++;
+            }
+            *alpha = ALPHA_OPAQUE;
+            if (transparent > 0 && partial > ALPHA_BLEND_SHARE * transparent)
+                *alpha = ALPHA_BLENDED;
+            else if (cutout > 0)
+                *alpha = ALPHA_MASKED;
+        }
+
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        if (TextureStreamer::Get().Enabled)   // the small mips now, the rest once the texture is seen up close
+            TextureStreamer::Get().Add(textureID, filename, data, width, height, nrComponents, format, format);
+        else
+        {
+            MipChain chain;
+            chain.Generate(filename, data, width, height, nrComponents, false);
+            chain.Upload(data, format, format);
+            ResourceRegistry::Get().Track(RESOURCE_TEXTURE, textureID,
+                                          ResourceRegistry::TextureBytes(width, height, nrComponents, true), filename);
+        }
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
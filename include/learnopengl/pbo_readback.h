@@ -0,0 +1,156 @@
+#ifndef PBO_READBACK_H
+#define PBO_READBACK_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/resource_registry.h>
+
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+// Default readback values
+const unsigned int READBACK_BUFFERS = 3;               // readbacks in flight
+const GLuint64 READBACK_WAIT_TIMEOUT = 1000000000ull;  // ns, per wait when a result is needed right away
+const unsigned int READBACK_WAIT_RETRIES = 10;         // waits per readback before it is given up (lost context)
+
+
+// pixels of a finished readback, RGBA8 with the top row first
+struct ReadbackImage {
+    unsigned int Tag;   // passed to Request, identifies the image to the caller
+    int Width, Height;
+    std::vector<unsigned char> Pixels;
+};
+
+// Reads the framebuffer back through a ring of pixel buffer objects. glReadPixels into a bound GL_PIXEL_PACK_BUFFER
+// only queues a copy on the GPU; a fence tells when it finished, and only then is the buffer mapped, so reading
+// pixels never stalls the pipeline the way a plain glReadPixels into client memory does.
+class PboReadback
+{
+public:
+    // queues a copy of the given rectangle of the current read framebuffer; returns false if every buffer of the
+    // ring is still in flight, Collect frees them
+    bool Request(int x, int y, int width, int height, unsigned int tag)
+    {
+        int free = -1;
+        for (unsigned int i = 0; i < READBACK_BUFFERS && free < 0; i++)
+            if (!slots[i].Busy)
+                free = (int) i;
+        if (free < 0)
+            return false;
+
+        Slot &slot = slots[free];
+        size_t size = (size_t) width * height * 4;
+        if (slot.Buffer == 0)
+            glGenBuffers(1, &slot.Buffer);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer);
+        if (slot.Capacity < size) {
+            glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+            slot.Capacity = size;
+            ResourceRegistry::Get().Track(RESOURCE_BUFFER, slot.Buffer, size, "Readback buffer");
+        }
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        glReadPixels(x, y, width, height, GL_RGBA, GL_UNSIGNED_BYTE, (void *) 0);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.Width = width;
+        slot.Height = height;
+        slot.Tag = tag;
+        slot.Busy = true;
+        order.push_back((unsigned int) free);
+        return true;
+    }
+
+    // hands every finished readback to callback(ReadbackImage &), oldest first; with wait it blocks until all
+    // requested readbacks are done, or given up after READBACK_WAIT_RETRIES timeouts. A readback whose fence fails
+    // is dropped and reported. Returns the number of images delivered.
+    template <typename Callback>
+    unsigned int Collect(Callback callback, bool wait = false)
+    {
+        unsigned int delivered = 0;
+        unsigned int retries = 0;
+        while (!order.empty()) {
+            Slot &slot = slots[order.front()];
+            GLenum status = glClientWaitSync(slot.Fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, wait ? READBACK_WAIT_TIMEOUT : 0);
+            if (status == GL_TIMEOUT_EXPIRED && wait && ++retries < READBACK_WAIT_RETRIES)
+                continue;
+            if (status == GL_TIMEOUT_EXPIRED && !wait)
+                break;  // later copies were queued after this one, they cannot be done either
+            if (status == GL_TIMEOUT_EXPIRED || status == GL_WAIT_FAILED) {
+                std::cout << "ERROR::READBACK:: " << (status == GL_WAIT_FAILED ? "Fence wait failed" : "Timed out")
+                          << ", readback " << slot.Tag << " dropped" << std::endl;
+                release(slot);
+                retries = 0;
+                continue;
+            }
+            retries = 0;
+
+            ReadbackImage image;
+            image.Tag = slot.Tag;
+            image.Width = slot.Width;
+            image.Height = slot.Height;
+            image.Pixels.resize((size_t) slot.Width * slot.Height * 4);
+            size_t rowSize = (size_t) slot.Width * 4;
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.Buffer);
+            const unsigned char *mapped = (const unsigned char *) glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, image.Pixels.size(), GL_MAP_READ_BIT);
+            if (mapped) {
+                // GL rows start at the bottom
+                for (int row = 0; row < slot.Height; row++)
+                    std::memcpy(&image.Pixels[row * rowSize], mapped + (slot.Height - 1 - row) * rowSize, rowSize);
+                glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            }
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+            release(slot);
+            if (mapped) {
+                callback(image);
+                delivered++;
+            }
+        }
+        return delivered;
+    }
+
+    unsigned int Pending() const
+    {
+        return (unsigned int) order.size();
+    }
+
+    void Destroy()
+    {
+        for (Slot &slot : slots) {
+            if (slot.Fence)
+                glDeleteSync(slot.Fence);
+            if (slot.Buffer) {
+                glDeleteBuffers(1, &slot.Buffer);
+                ResourceRegistry::Get().Untrack(RESOURCE_BUFFER, slot.Buffer);
+            }
+            slot = Slot();
+        }
+        order.clear();
+    }
+
+private:
+    struct Slot {
+        GLuint Buffer = 0;
+        GLsync Fence = 0;
+        size_t Capacity = 0;
+        int Width = 0, Height = 0;
+        unsigned int Tag = 0;
+        bool Busy = false;
+    };
+
+    Slot slots[READBACK_BUFFERS];
+    std::deque<unsigned int> order;   // busy slots in request order
+
+    // frees the oldest slot, which is slot
+    void release(Slot &slot)
+    {
+        glDeleteSync(slot.Fence);
+        slot.Fence = 0;
+        slot.Busy = false;
+        order.pop_front();
+    }
+};
+#endif
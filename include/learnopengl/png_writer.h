@@ -0,0 +1,132 @@
+#ifndef PNG_WRITER_H
+#define PNG_WRITER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Minimal PNG encoder for 8-bit RGB/RGBA images, top row first. The image data goes into stored (uncompressed)
+// deflate blocks: files are larger than from a real encoder, but writing one costs little more than a memcpy
+// and needs no extra library next to stb_image.
+class PngWriter
+{
+public:
+    static bool Write(const std::string &path, int width, int height, int channels, const unsigned char *pixels)
+    {
+        std::vector<unsigned char> png;
+        Encode(width, height, channels, pixels, png);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out || !out.write((const char *) png.data(), png.size())) {
+            std::cout << "ERROR::PNG:: Could not write " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    static void Encode(int width, int height, int channels, const unsigned char *pixels, std::vector<unsigned char> &png)
+    {
+        static const unsigned char signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        png.assign(signature, signature + 8);
+
+        std::vector<unsigned char> header;
+        put32(header, (uint32_t) width);
+        put32(header, (uint32_t) height);
+        header.push_back(8);                          // bit depth
+        header.push_back(channels == 4 ? 6 : 2);      // color type: RGBA or RGB
+        header.push_back(0);                          // deflate
+        header.push_back(0);                          // adaptive filtering
+        header.push_back(0);                          // no interlace
+        chunk(png, "IHDR", header);
+
+        // every row starts with its filter type, 0 = none
+        size_t rowSize = (size_t) width * channels;
+        std::vector<unsigned char> raw;
+        raw.reserve((rowSize + 1) * height);
+        for (int y = 0; y < height; y++) {
+            raw.push_back(0);
+            raw.insert(raw.end(), pixels + y * rowSize, pixels + (y + 1) * rowSize);
+        }
+
+        std::vector<unsigned char> zlib;
+        zlib.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+        zlib.push_back(0x78);
+        zlib.push_back(0x01);
+        for (size_t offset = 0; offset < raw.size(); offset += 65535) {
+            size_t length = std::min(raw.size() - offset, (size_t) 65535);
+            zlib.push_back(offset + length == raw.size() ? 1 : 0);   // BFINAL, BTYPE = stored
+            zlib.push_back((unsigned char) (length & 0xff));
+            zlib.push_back((unsigned char) (length >> 8));
+            zlib.push_back((unsigned char) (~length & 0xff));
+            zlib.push_back((unsigned char) ((~length >> 8) & 0xff));
+            zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + length);
+        }
+        put32(zlib, adler32(raw));
+        chunk(png, "IDAT", zlib);
+        chunk(png, "IEND", std::vector<unsigned char>());
+    }
+
+    // RGBA to RGB
+    static std::vector<unsigned char> DropAlpha(const std::vector<unsigned char> &rgba)
+    {
+        std::vector<unsigned char> rgb(rgba.size() / 4 * 3);
+        for (size_t i = 0, j = 0; i < rgba.size(); i += 4, j += 3) {
+            rgb[j] = rgba[i];
+            rgb[j + 1] = rgba[i + 1];
+            rgb[j + 2] = rgba[i + 2];
+        }
+        return rgb;
+    }
+
+private:
+    static void put32(std::vector<unsigned char> &out, uint32_t value)
+    {
+        out.push_back((unsigned char) (value >> 24));
+        out.push_back((unsigned char) (value >> 16));
+        out.push_back((unsigned char) (value >> 8));
+        out.push_back((unsigned char) value);
+    }
+
+    static void chunk(std::vector<unsigned char> &png, const char *type, const std::vector<unsigned char> &data)
+    {
+        put32(png, (uint32_t) data.size());
+        size_t start = png.size();
+        png.insert(png.end(), type, type + 4);
+        png.insert(png.end(), data.begin(), data.end());
+        put32(png, crc32(&png[start], png.size() - start));
+    }
+
+    static uint32_t crc32(const unsigned char *data, size_t size)
+    {
+        static const std::vector<uint32_t> table = crcTable();
+        uint32_t crc = 0xffffffffu;
+        for (size_t i = 0; i < size; i++)
+            crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+        return crc ^ 0xffffffffu;
+    }
+
+    static std::vector<uint32_t> crcTable()
+    {
+        std::vector<uint32_t> table(256);
+        for (uint32_t n = 0; n < 256; n++) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        return table;
+    }
+
+    static uint32_t adler32(const std::vector<unsigned char> &data)
+    {
+        uint32_t a = 1, b = 0;
+        for (size_t i = 0; i < data.size(); i++) {
+            a = (a + data[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        return (b << 16) | a;
+    }
+};
+#endif
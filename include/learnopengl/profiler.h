@@ -0,0 +1,299 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Frame profiler. Build with -DENABLE_PROFILER (cmake -DENABLE_PROFILER=ON) to enable it; otherwise every macro
+// below expands to nothing and the profiler costs nothing at all.
+//
+//     PROFILE_BEGIN_FRAME();
+//     {
+//         PROFILE_GPU_SCOPE("Trees");   // CPU time plus GPU time measured with timestamp queries
+//         PROFILE_SCOPE("Culling");     // CPU time only
+//     }
+//     PROFILE_END_FRAME();
+//     ...
+//     PROFILE_SHUTDOWN();                 // at exit, deletes the timestamp queries
+
+#ifdef ENABLE_PROFILER
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, false)
+#define PROFILE_GPU_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name, true)
+#define PROFILE_BEGIN_FRAME() Profiler::Get().BeginFrame()
+#define PROFILE_END_FRAME() Profiler::Get().EndFrame()
+#define PROFILE_SHUTDOWN() Profiler::Get().Destroy()
+
+// Default profiler values
+const unsigned int PROFILER_FRAMES = 4;    // frames of queries in flight; GPU results are read this many frames late
+const float PROFILER_SMOOTHING     = 0.1f; // weight of the newest frame in the displayed averages
+
+
+struct ProfileSample {
+    const char *Name;
+    int Depth;
+    double CpuStart, CpuEnd;   // seconds since the profiler was created
+    int GpuQuery;              // first of the two timestamp queries in the frame's pool, -1 for CPU-only scopes
+    double GpuStart, GpuEnd;   // GPU timestamps in seconds, relative to the start of the frame
+};
+
+// one row of the hierarchical view; times are smoothed over several frames
+struct ProfileResult {
+    const char *Name;
+    int Depth;
+    float CpuMs;
+    float GpuMs;     // negative for CPU-only scopes
+};
+
+// Collects nested CPU scopes and GPU timestamp queries per frame. Queries are kept in a ring of PROFILER_FRAMES
+// pools and only read back when the ring wraps around, so reading results never waits for the GPU. GL_TIMESTAMP
+// counters are used instead of GL_TIME_ELAPSED because elapsed-time queries cannot be nested.
+class Profiler
+{
+public:
+    std::vector<ProfileResult> Results;   // last resolved frame, in scope order
+
+    static Profiler &Get()
+    {
+        static Profiler profiler;
+        return profiler;
+    }
+
+    void BeginFrame()
+    {
+        frameIndex++;
+        Frame &frame = frames[frameIndex % PROFILER_FRAMES];
+        if (frame.InFlight)
+            resolve(frame);
+
+        frame.Samples.clear();
+        frame.UsedQueries = 0;
+        frame.InFlight = true;
+        frame.CpuStart = now();
+        frame.StartQuery = allocateQuery(frame);
+        glQueryCounter(frame.Queries[frame.StartQuery], GL_TIMESTAMP);
+        stack.clear();
+    }
+
+    void EndFrame()
+    {
+        while (!stack.empty())
+            End();
+    }
+
+    void Begin(const char *name, bool gpu)
+    {
+        Frame &frame = current();
+        ProfileSample sample;
+        sample.Name = name;
+        sample.Depth = (int) stack.size();
+        sample.CpuStart = now();
+        sample.CpuEnd = sample.CpuStart;
+        sample.GpuQuery = -1;
+        sample.GpuStart = sample.GpuEnd = 0.0;
+        if (gpu) {
+            sample.GpuQuery = allocateQuery(frame);
+            allocateQuery(frame);
+            glQueryCounter(frame.Queries[sample.GpuQuery], GL_TIMESTAMP);
+        }
+        stack.push_back(frame.Samples.size());
+        frame.Samples.push_back(sample);
+    }
+
+    void End()
+    {
+        if (stack.empty())
+            return;
+        Frame &frame = current();
+        ProfileSample &sample = frame.Samples[stack.back()];
+        stack.pop_back();
+        if (sample.GpuQuery >= 0)
+            glQueryCounter(frame.Queries[sample.GpuQuery + 1], GL_TIMESTAMP);
+        sample.CpuEnd = now();
+    }
+
+    // deletes the query pools of every frame; call before the context goes away
+    void Destroy()
+    {
+        for (Frame &frame : frames) {
+            if (!frame.Queries.empty())
+                glDeleteQueries((GLsizei) frame.Queries.size(), frame.Queries.data());
+            frame.Queries.clear();
+            frame.Samples.clear();
+            frame.UsedQueries = 0;
+            frame.InFlight = false;
+        }
+        stack.clear();
+    }
+
+    // records the next `frames` resolved frames and writes them as Chrome trace events (chrome://tracing, Perfetto)
+    void StartTrace(const std::string &path, unsigned int frames)
+    {
+        tracePath = path;
+        traceFramesLeft = frames;
+        traceEvents.str("");
+        traceEvents.clear();
+        traceEventCount = 0;
+    }
+
+    bool Tracing() const
+    {
+        return traceFramesLeft > 0;
+    }
+
+private:
+    struct Frame {
+        std::vector<ProfileSample> Samples;
+        std::vector<GLuint> Queries;
+        unsigned int UsedQueries = 0;
+        int StartQuery = 0;
+        double CpuStart = 0.0;
+        bool InFlight = false;
+    };
+
+    Frame frames[PROFILER_FRAMES];
+    unsigned long long frameIndex;
+    std::vector<size_t> stack;
+    std::chrono::steady_clock::time_point epoch;
+
+    std::string tracePath;
+    unsigned int traceFramesLeft;
+    std::stringstream traceEvents;
+    unsigned int traceEventCount;
+
+    Profiler() : frameIndex(0), epoch(std::chrono::steady_clock::now()), traceFramesLeft(0), traceEventCount(0) {}
+
+    Frame &current()
+    {
+        return frames[frameIndex % PROFILER_FRAMES];
+    }
+
+    double now() const
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - epoch).count();
+    }
+
+    int allocateQuery(Frame &frame)
+    {
+        if (frame.UsedQueries == frame.Queries.size()) {
+            GLuint query;
+            glGenQueries(1, &query);
+            frame.Queries.push_back(query);
+        }
+        return (int) frame.UsedQueries++;
+    }
+
+    // reads back a frame that was submitted PROFILER_FRAMES ago; drops its GPU times instead of stalling if the
+    // GPU is still behind
+    void resolve(Frame &frame)
+    {
+        frame.InFlight = false;
+        GLint available = 0;
+        glGetQueryObjectiv(frame.Queries[frame.UsedQueries - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+
+        GLuint64 frameStart = 0;
+        if (available)
+            glGetQueryObjectui64v(frame.Queries[frame.StartQuery], GL_QUERY_RESULT, &frameStart);
+        for (ProfileSample &sample : frame.Samples) {
+            if (sample.GpuQuery < 0 || !available)
+                continue;
+            GLuint64 begin = 0, end = 0;
+            glGetQueryObjectui64v(frame.Queries[sample.GpuQuery], GL_QUERY_RESULT, &begin);
+            glGetQueryObjectui64v(frame.Queries[sample.GpuQuery + 1], GL_QUERY_RESULT, &end);
+            sample.GpuStart = (double) (begin - frameStart) / 1.0e9;
+            sample.GpuEnd = (double) (end - frameStart) / 1.0e9;
+        }
+
+        publish(frame, available != 0);
+        if (traceFramesLeft > 0)
+            trace(frame, available != 0);
+    }
+
+    void publish(const Frame &frame, bool gpuAvailable)
+    {
+        // keep the smoothed values while the scope layout stays the same, start over when it changes
+        bool sameLayout = Results.size() == frame.Samples.size();
+        for (size_t i = 0; sameLayout && i < frame.Samples.size(); i++)
+            sameLayout = Results[i].Name == frame.Samples[i].Name;
+        if (!sameLayout)
+            Results.assign(frame.Samples.size(), ProfileResult{nullptr, 0, 0.0f, -1.0f});
+
+        for (size_t i = 0; i < frame.Samples.size(); i++) {
+            const ProfileSample &sample = frame.Samples[i];
+            ProfileResult &result = Results[i];
+            float cpuMs = (float) ((sample.CpuEnd - sample.CpuStart) * 1000.0);
+            float gpuMs = (float) ((sample.GpuEnd - sample.GpuStart) * 1000.0);
+            float weight = sameLayout ? PROFILER_SMOOTHING : 1.0f;
+            result.Name = sample.Name;
+            result.Depth = sample.Depth;
+            result.CpuMs += (cpuMs - result.CpuMs) * weight;
+            if (sample.GpuQuery < 0)
+                result.GpuMs = -1.0f;
+            else if (gpuAvailable)
+                result.GpuMs = result.GpuMs < 0.0f ? gpuMs : result.GpuMs + (gpuMs - result.GpuMs) * weight;
+        }
+    }
+
+    // CPU scopes go on thread 1 and GPU scopes on thread 2; GPU times are placed relative to the CPU frame start
+    void trace(const Frame &frame, bool gpuAvailable)
+    {
+        for (const ProfileSample &sample : frame.Samples) {
+            writeTraceEvent(sample.Name, "cpu", 1, sample.CpuStart, sample.CpuEnd - sample.CpuStart);
+            if (sample.GpuQuery >= 0 && gpuAvailable)
+                writeTraceEvent(sample.Name, "gpu", 2, frame.CpuStart + sample.GpuStart, sample.GpuEnd - sample.GpuStart);
+        }
+
+        if (--traceFramesLeft > 0)
+            return;
+        std::ofstream out(tracePath);
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n"
+            << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}"
+            << traceEvents.str() << "\n]}\n";
+        std::cout << "Profiler trace with " << traceEventCount << " events written to " << tracePath << std::endl;
+    }
+
+    void writeTraceEvent(const char *name, const char *category, int thread, double start, double duration)
+    {
+        traceEvents << ",\n{\"name\":\"" << name << "\",\"cat\":\"" << category << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                    << thread << ",\"ts\":" << (long long) (start * 1.0e6) << ",\"dur\":" << duration * 1.0e6 << "}";
+        traceEventCount++;
+    }
+};
+
+// ends the scope it was opened in; created through PROFILE_SCOPE / PROFILE_GPU_SCOPE
+class ProfileScope
+{
+public:
+    ProfileScope(const char *name, bool gpu)
+    {
+        Profiler::Get().Begin(name, gpu);
+    }
+
+    ~ProfileScope()
+    {
+        Profiler::Get().End();
+    }
+
+    ProfileScope(const ProfileScope &) = delete;
+    ProfileScope &operator=(const ProfileScope &) = delete;
+};
+
+#else
+
+#define PROFILE_SCOPE(name)
+#define PROFILE_GPU_SCOPE(name)
+#define PROFILE_BEGIN_FRAME()
+#define PROFILE_END_FRAME()
+#define PROFILE_SHUTDOWN()
+
+#endif
+#endif
@@ -0,0 +1,154 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/content_hash.h>
+#include <learnopengl/gl_extensions.h>
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// GL 4.1 / ARB_get_program_binary, not part of the 3.3 core glad loader
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+// Default program cache values
+const unsigned int PROGRAM_CACHE_VERSION  = 1;
+const char *const PROGRAM_CACHE_DIRECTORY = "resources/cache/";
+
+
+// Linked program binaries on disk, so a launch with unchanged shaders skips GLSL compilation. A binary is keyed by
+// the ContentHash of the program's sources together with the GL vendor, renderer and version strings: a driver
+// update or a different GPU simply misses. The driver may still reject a binary it wrote itself (e.g. after a
+// silent update); Shader then compiles from source and overwrites the file.
+//
+// Needs GL 4.1 or ARB_get_program_binary and at least one binary format; otherwise Enabled stays false and every
+// program is compiled as before.
+class ProgramCache
+{
+public:
+    bool Enabled = false;
+    unsigned int Hits = 0;
+    unsigned int Misses = 0;
+    unsigned int Rejected = 0;
+
+    static ProgramCache &Get()
+    {
+        static ProgramCache cache;
+        return cache;
+    }
+
+    // loads the entry points through the same loader as glad; call once the context is current
+    void Init(GLADloadproc loader)
+    {
+        getProgramBinary = (GetProgramBinaryProc) loader("glGetProgramBinary");
+        programBinary = (ProgramBinaryProc) loader("glProgramBinary");
+        programParameteri = (ProgramParameteriProc) loader("glProgramParameteri");
+        GLint formats = 0;
+        bool supported = (GLVersion.major == 4 && GLVersion.minor >= 1) || GLVersion.major > 4 ||
+                         HasGLExtension("GL_ARB_get_program_binary");
+        if (getProgramBinary && programBinary && programParameteri && supported)
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        Enabled = formats > 0;
+
+        driver = std::string((const char *) glGetString(GL_VENDOR)) + '\n' +
+                 (const char *) glGetString(GL_RENDERER) + '\n' + (const char *) glGetString(GL_VERSION);
+    }
+
+    // key of a program built from the given sources with the current driver
+    uint64_t Key(const std::vector<std::string> &sources) const
+    {
+        uint64_t hash = ContentHash(&PROGRAM_CACHE_VERSION, sizeof(PROGRAM_CACHE_VERSION));
+        hash = ContentHash(driver, hash);
+        for (const std::string &source : sources) {
+            uint64_t size = source.size();   // so moving text between stages changes the key
+            hash = ContentHash(&size, sizeof(size), hash);
+            hash = ContentHash(source, hash);
+        }
+        return hash;
+    }
+
+    // loads the cached binary into program; false if there is none or the driver rejects it
+    bool Load(GLuint program, uint64_t key)
+    {
+        if (!Enabled)
+            return false;
+        std::ifstream in(path(key), std::ios::binary);
+        GLenum format = 0;
+        if (!in.read((char *) &format, sizeof(format))) {
+            Misses++;
+            return false;
+        }
+        std::vector<char> binary((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        programBinary(program, format, binary.data(), (GLsizei) binary.size());
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (!linked) {
+            Rejected++;
+            return false;
+        }
+        Hits++;
+        return true;
+    }
+
+    // asks the driver to keep the binary of program retrievable; call before glLinkProgram
+    void PrepareLink(GLuint program) const
+    {
+        if (Enabled)
+            programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // writes the binary of a linked program
+    void Store(GLuint program, uint64_t key) const
+    {
+        if (!Enabled)
+            return;
+        GLint length = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+        if (length <= 0)
+            return;
+        std::vector<char> binary(length);
+        GLenum format = 0;
+        getProgramBinary(program, length, nullptr, &format, binary.data());
+
+        std::ofstream out(path(key), std::ios::binary);
+        out.write((const char *) &format, sizeof(format));
+        out.write(binary.data(), binary.size());
+        if (!out)
+            std::cout << "ERROR::PROGRAM_CACHE:: Failed to write " << path(key) << std::endl;
+    }
+
+private:
+    typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei *length,
+                                                  GLenum *binaryFormat, void *binary);
+    typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void *binary, GLsizei length);
+    typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+    GetProgramBinaryProc getProgramBinary = nullptr;
+    ProgramBinaryProc programBinary = nullptr;
+    ProgramParameteriProc programParameteri = nullptr;
+    std::string driver;
+
+    ProgramCache() = default;
+
+    static std::string path(uint64_t key)
+    {
+        char name[32];
+        std::snprintf(name, sizeof(name), "program_%016llx.bin", (unsigned long long) key);
+        return std::string(PROGRAM_CACHE_DIRECTORY) + name;
+    }
+};
+#endif
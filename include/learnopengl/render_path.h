@@ -0,0 +1,13 @@
+#ifndef RENDER_PATH_H
+#define RENDER_PATH_H
+
+// How the lit models are shaded.
+enum Render_Path {
+    RENDER_FORWARD,     // 2.model_lighting.fs, the directional light and the main point light only
+    RENDER_DEFERRED,    // G-buffer plus stencil-bounded light volumes, every scene light
+    RENDER_CLUSTERED    // forward, every scene light through the per-cluster light lists of LightClusters
+};
+
+const char *const RENDER_PATH_NAMES[] = {"Forward", "Deferred", "Clustered forward"};
+const int RENDER_PATH_COUNT = 3;
+#endif
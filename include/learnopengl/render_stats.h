@@ -0,0 +1,29 @@
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+// Counts the draw calls and triangles submitted during a frame. Every place that issues a draw reports it here,
+// the render loop resets the counters at the start of each frame.
+struct RenderStats {
+    unsigned int DrawCalls = 0;
+    unsigned long long Triangles = 0;
+
+    static RenderStats &Get()
+    {
+        static RenderStats stats;
+        return stats;
+    }
+
+    void Reset()
+    {
+        DrawCalls = 0;
+        Triangles = 0;
+    }
+
+    // vertexCount is the number of indices/vertices passed to a GL_TRIANGLES draw
+    void AddDraw(unsigned long long vertexCount)
+    {
+        DrawCalls++;
+        Triangles += vertexCount / 3;
+    }
+};
+#endif
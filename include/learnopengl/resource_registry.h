@@ -0,0 +1,123 @@
+#ifndef RESOURCE_REGISTRY_H
+#define RESOURCE_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+// What a registered resource is; GL handles of different kinds may share a number.
+enum Resource_Kind {
+    RESOURCE_TEXTURE,
+    RESOURCE_BUFFER,
+    RESOURCE_RENDERBUFFER,
+    RESOURCE_CPU   // asset data kept in memory, keyed by the address of its owner
+};
+
+const char *const RESOURCE_KIND_NAMES[] = {"Texture", "Buffer", "Renderbuffer", "CPU"};
+const int RESOURCE_KIND_COUNT = 4;
+
+// Default resource registry values
+const size_t RESOURCE_GPU_BUDGET = (size_t) 512 << 20;
+
+
+// Sizes of the GL textures, buffers and renderbuffers and of the CPU asset copies, with who owns them. Whatever
+// allocates one reports it with Track (again with the new size when it is respecified) and removes it with
+// Untrack. GPU sizes are what the data needs, drivers add padding and alignment on top.
+//
+// Budget covers the GPU kinds. Render targets and fixed textures cannot shrink, so the TextureStreamer gets what
+// they leave and downscales or evicts streamed mips when that is less than it holds.
+class ResourceRegistry
+{
+public:
+    struct Resource {
+        Resource_Kind Kind;
+        uintptr_t Handle;
+        size_t Bytes;
+        std::string Owner;
+    };
+
+    // scratch memory of one asset import, see LinearArena
+    struct Import {
+        std::string Owner;
+        unsigned int Allocations;         // served by the arena
+        unsigned int SystemAllocations;   // of them, what the arena took from the system
+        size_t PeakBytes;
+    };
+
+    size_t Budget = RESOURCE_GPU_BUDGET;
+
+    static ResourceRegistry &Get()
+    {
+        static ResourceRegistry registry;
+        return registry;
+    }
+
+    // size of a texture with the given texel size, with its mip chain if mipmapped
+    static size_t TextureBytes(int width, int height, int bytesPerTexel, bool mipmapped = false)
+    {
+        size_t bytes = (size_t) width * height * bytesPerTexel;
+        return mipmapped ? bytes + bytes / 3 : bytes;
+    }
+
+    void Track(Resource_Kind kind, uintptr_t handle, size_t bytes, const std::string &owner)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        Resource &resource = resources[std::make_pair(kind, handle)];
+        totals[kind] += bytes - resource.Bytes;
+        resource = Resource{kind, handle, bytes, owner};
+    }
+
+    void Untrack(Resource_Kind kind, uintptr_t handle)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        auto found = resources.find(std::make_pair(kind, handle));
+        if (found == resources.end())
+            return;
+        totals[kind] -= found->second.Bytes;
+        resources.erase(found);
+    }
+
+    size_t Total(Resource_Kind kind) const
+    {
+        return totals[kind];
+    }
+    size_t GpuBytes() const
+    {
+        return totals[RESOURCE_TEXTURE] + totals[RESOURCE_BUFFER] + totals[RESOURCE_RENDERBUFFER];
+    }
+
+    void AddImport(const Import &import)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        imports.push_back(import);
+    }
+    std::vector<Import> Imports()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        return imports;
+    }
+
+    // a copy of every registered resource, for listing
+    std::vector<Resource> List()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<Resource> list;
+        list.reserve(resources.size());
+        for (auto &entry : resources)
+            list.push_back(entry.second);
+        return list;
+    }
+
+private:
+    std::map<std::pair<Resource_Kind, uintptr_t>, Resource> resources;
+    size_t totals[RESOURCE_KIND_COUNT] = {0, 0, 0, 0};
+    std::vector<Import> imports;
+    std::mutex mutex;
+
+    ResourceRegistry() = default;
+};
+#endif
@@ -8,105 +8,74 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <functional>
+#include <chrono>
+#include <vector>
 #include <common.h>
+#include <learnopengl/program_cache.h>
+#include <learnopengl/shader_compiler.h>
+
+// How a Shader's program is built.
+enum Shader_Compile {
+    COMPILE_BLOCKING,   // the program is ready when the constructor returns
+    COMPILE_ASYNC       // the constructor only submits the work, see Ready()
+};
+
 class Shader
 {
 public:
     unsigned int ID;
+    // called after a Reload swapped in the new program, with it in use; restores the uniforms set once at startup
+    // (sampler units and the like), which the new program starts without
+    std::function<void(Shader&)> OnReload;
+    // only Ready swaps in a finished build, use keeps the current program (ShaderVariants, whose per-frame uniforms
+    // a program swapped in mid-frame would miss)
+    bool HoldBuilds = false;
+
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
     Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+        : Shader(vertexPath, fragmentPath, COMPILE_BLOCKING, geometryPath)
     {
-        std::string vertexPathString(vertexPath);
-        std::string fragmentPathString(fragmentPath);
-
-        vertexPath = vertexPathString.c_str();
-        fragmentPath= fragmentPathString.c_str();
-        // 1. retrieve the vertex/fragment source code from filePath
-        std::string vertexCode;
-        std::string fragmentCode;
-        std::string geometryCode;
-        std::ifstream vShaderFile;
-        std::ifstream fShaderFile;
-        std::ifstream gShaderFile;
-        // ensure ifstream objects can throw exceptions:
-        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
-        try 
-        {
-            // open files
-            vShaderFile.open(vertexPath);
-            fShaderFile.open(fragmentPath);
-            std::stringstream vShaderStream, fShaderStream;
-            // read file's buffer contents into streams
-            vShaderStream << vShaderFile.rdbuf();
-            fShaderStream << fShaderFile.rdbuf();		
-            // close file handlers
-            vShaderFile.close();
-            fShaderFile.close();
-            // convert stream into string
-            vertexCode = vShaderStream.str();
-            fragmentCode = fShaderStream.str();			
-            // if geometry shader path is present, also load a geometry shader
-            if(geometryPath != nullptr)
-            {
-                std::string geometryPathString(geometryPath);
-                geometryPath = geometryPathString.c_str();
-                gShaderFile.open(geometryPath);
-                std::stringstream gShaderStream;
-                gShaderStream << gShaderFile.rdbuf();
-                gShaderFile.close();
-                geometryCode = gShaderStream.str();
-            }
-        }
-        catch (std::ifstream::failure& e)
-        {
-            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
-        }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // if geometry shader is given, compile geometry shader
-        unsigned int geometry;
-        if(geometryPath != nullptr)
-        {
-            const char * gShaderCode = geometryCode.c_str();
-            geometry = glCreateShader(GL_GEOMETRY_SHADER);
-            glShaderSource(geometry, 1, &gShaderCode, NULL);
-            glCompileShader(geometry);
-            checkCompileErrors(geometry, "GEOMETRY");
-        }
-        // shader Program
-        ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        if(geometryPath != nullptr)
-            glAttachShader(ID, geometry);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessery
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
-        if(geometryPath != nullptr)
-            glDeleteShader(geometry);
-
+    }
+    // with COMPILE_ASYNC, ID stays 0 until the program is ready; draws with it are skipped meanwhile
+    Shader(const char* vertexPath, const char* fragmentPath, Shader_Compile compile, const char* geometryPath = nullptr)
+        : ID(0), vertexPath(vertexPath), fragmentPath(fragmentPath), geometryPath(geometryPath ? geometryPath : "")
+    {
+        submit();
+        activate(compile == COMPILE_BLOCKING);
+    }
+    // a variant of the sources: every stage gets a "#define NAME" per entry right after its #version line
+    Shader(const char* vertexPath, const char* fragmentPath, const std::vector<std::string> &defines, Shader_Compile compile)
+        : ID(0), vertexPath(vertexPath), fragmentPath(fragmentPath), defines(defines)
+    {
+        submit();
+        activate(compile == COMPILE_BLOCKING);
+    }
+    // builds the program again from the current files, in the background; the old program stays in use until the
+    // new one has linked, and stays for good if it fails to
+    void Reload()
+    {
+        if (building.Program == 0)
+            submit();
+    }
+    // true once a program is in use; finishes a pending build if the driver is done with it, without waiting
+    bool Ready()
+    {
+        activate(false);
+        return ID != 0;
+    }
+    // true while a build (the first one or a Reload) is in flight
+    bool Building() const
+    {
+        return building.Program != 0;
     }
     // activate the shader
     // ------------------------------------------------------------------------
     void use() 
     { 
+        if (!HoldBuilds)
+            activate(false);
         glUseProgram(ID); 
     }
     // utility uniform functions
@@ -143,6 +112,10 @@ public:
     { 
         glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z); 
     }
+    void setIVec3(const std::string &name, int x, int y, int z) const
+    { 
+        glUniform3i(glGetUniformLocation(ID, name.c_str()), x, y, z); 
+    }
     // ------------------------------------------------------------------------
     void setVec4(const std::string &name, const glm::vec4 &value) const
     { 
@@ -169,6 +142,194 @@ public:
     }
 
 private:
+    // a program being compiled and linked, not yet in use
+    struct Build {
+        unsigned int Program = 0, Vertex = 0, Fragment = 0, Geometry = 0;
+        uint64_t Key = 0;
+        bool FromCache = false;
+        std::chrono::steady_clock::time_point Submitted;
+    };
+
+    std::string vertexPath, fragmentPath, geometryPath;
+    std::vector<std::string> defines;
+    Build building;
+
+    // inserts the variant's defines after the #version line, which has to stay the first statement
+    std::string specialize(const std::string &code) const
+    {
+        if (defines.empty() || code.empty())
+            return code;
+        std::string block;
+        for (const std::string &define : defines)
+            block += "#define " + define + "\n";
+        size_t version = code.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        if (lineEnd == std::string::npos)
+            return block + code;
+        return code.substr(0, lineEnd + 1) + block + code.substr(lineEnd + 1);
+    }
+
+    // replaces each #include "file" line with that file, found next to the including one, so the shaders can share
+    // functions (scene_lighting.glsl); included files may include others
+    static std::string expandIncludes(const std::string &code, const std::string &path, int depth = 0)
+    {
+        if (code.find("#include") == std::string::npos)
+            return code;
+        std::string directory = path.substr(0, path.find_last_of("/\\") + 1);
+        std::istringstream lines(code);
+        std::string line, result;
+        while (std::getline(lines, line)) {
+            size_t directive = line.find_first_not_of(" \t");
+            size_t open = line.find('"');
+            size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+            if (directive == std::string::npos || line.compare(directive, 8, "#include") != 0 || close == std::string::npos) {
+                result += line + "\n";
+                continue;
+            }
+            std::string included = directory + line.substr(open + 1, close - open - 1);
+            std::ifstream file(included);
+            if (!file || depth >= 8) {
+                std::cout << "ERROR::SHADER::INCLUDE_NOT_READ " << included << std::endl;
+                continue;
+            }
+            std::stringstream stream;
+            stream << file.rdbuf();
+            result += expandIncludes(stream.str(), included, depth + 1) + "\n";
+        }
+        return result;
+    }
+
+    // reads the sources and starts compiling and linking them; no status is queried, so the driver is free to
+    // do the work on its own threads
+    void submit()
+    {
+        // 1. retrieve the vertex/fragment source code from filePath
+        std::string vertexCode;
+        std::string fragmentCode;
+        std::string geometryCode;
+        std::ifstream vShaderFile;
+        std::ifstream fShaderFile;
+        std::ifstream gShaderFile;
+        // ensure ifstream objects can throw exceptions:
+        vShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        gShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        try 
+        {
+            // open files
+            vShaderFile.open(vertexPath);
+            fShaderFile.open(fragmentPath);
+            std::stringstream vShaderStream, fShaderStream;
+            // read file's buffer contents into streams
+            vShaderStream << vShaderFile.rdbuf();
+            fShaderStream << fShaderFile.rdbuf();		
+            // close file handlers
+            vShaderFile.close();
+            fShaderFile.close();
+            // convert stream into string
+            vertexCode = vShaderStream.str();
+            fragmentCode = fShaderStream.str();			
+            // if geometry shader path is present, also load a geometry shader
+            if(!geometryPath.empty())
+            {
+                gShaderFile.open(geometryPath);
+                std::stringstream gShaderStream;
+                gShaderStream << gShaderFile.rdbuf();
+                gShaderFile.close();
+                geometryCode = gShaderStream.str();
+            }
+        }
+        catch (std::ifstream::failure& e)
+        {
+            std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        }
+        vertexCode = specialize(expandIncludes(vertexCode, vertexPath));
+        fragmentCode = specialize(expandIncludes(fragmentCode, fragmentPath));
+        geometryCode = specialize(expandIncludes(geometryCode, geometryPath));
+
+        building = Build();
+        building.Submitted = std::chrono::steady_clock::now();
+        // a cached binary of the same sources skips compiling and linking
+        ProgramCache& programCache = ProgramCache::Get();
+        building.Key = programCache.Key({vertexCode, fragmentCode, geometryCode});
+        building.Program = glCreateProgram();
+        if (programCache.Load(building.Program, building.Key)) {
+            building.FromCache = true;
+            return;
+        }
+        glDeleteProgram(building.Program);
+
+        const char* vShaderCode = vertexCode.c_str();
+        const char * fShaderCode = fragmentCode.c_str();
+        // 2. compile shaders
+        // vertex shader
+        building.Vertex = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(building.Vertex, 1, &vShaderCode, NULL);
+        glCompileShader(building.Vertex);
+        // fragment Shader
+        building.Fragment = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(building.Fragment, 1, &fShaderCode, NULL);
+        glCompileShader(building.Fragment);
+        // if geometry shader is given, compile geometry shader
+        if(!geometryPath.empty())
+        {
+            const char * gShaderCode = geometryCode.c_str();
+            building.Geometry = glCreateShader(GL_GEOMETRY_SHADER);
+            glShaderSource(building.Geometry, 1, &gShaderCode, NULL);
+            glCompileShader(building.Geometry);
+        }
+        // shader Program
+        building.Program = glCreateProgram();
+        glAttachShader(building.Program, building.Vertex);
+        glAttachShader(building.Program, building.Fragment);
+        if(building.Geometry != 0)
+            glAttachShader(building.Program, building.Geometry);
+        programCache.PrepareLink(building.Program);
+        glLinkProgram(building.Program);
+    }
+
+    // puts the pending program in use once it has finished (or right away with wait); a program that failed to
+    // compile or link is dropped and the previous one kept
+    void activate(bool wait)
+    {
+        if (building.Program == 0)
+            return;
+        if (!wait && !building.FromCache && !ShaderCompiler::Get().Finished(building.Program, building.Submitted))
+            return;
+
+        GLint linked = GL_TRUE;
+        if (!building.FromCache) {
+            checkCompileErrors(building.Vertex, "VERTEX");
+            checkCompileErrors(building.Fragment, "FRAGMENT");
+            if(building.Geometry != 0)
+                checkCompileErrors(building.Geometry, "GEOMETRY");
+            checkCompileErrors(building.Program, "PROGRAM");
+            glGetProgramiv(building.Program, GL_LINK_STATUS, &linked);
+            if (linked)
+                ProgramCache::Get().Store(building.Program, building.Key);
+            // delete the shaders as they're linked into our program now and no longer necessery
+            glDeleteShader(building.Vertex);
+            glDeleteShader(building.Fragment);
+            if(building.Geometry != 0)
+                glDeleteShader(building.Geometry);
+        }
+
+        bool reloaded = false;
+        if (linked) {
+            reloaded = ID != 0;
+            if (ID != 0)
+                glDeleteProgram(ID);
+            ID = building.Program;
+        } else {
+            glDeleteProgram(building.Program);
+        }
+        building = Build();
+        if (reloaded && OnReload) {
+            glUseProgram(ID);
+            OnReload(*this);
+        }
+    }
+
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
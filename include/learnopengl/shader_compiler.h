@@ -0,0 +1,74 @@
+#ifndef SHADER_COMPILER_H
+#define SHADER_COMPILER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_extensions.h>
+
+#include <chrono>
+
+// KHR_parallel_shader_compile / ARB_parallel_shader_compile, not part of the 3.3 core glad loader
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// Default shader compiler values
+const std::chrono::milliseconds SHADER_COMPILE_GRACE(100);   // without the extension: time given to the driver
+                                                             // before asking for the status of a program
+
+
+// Whether the driver can tell, without blocking, that a program has finished compiling and linking. With
+// KHR_parallel_shader_compile (or the ARB version) the driver compiles on its own threads and
+// GL_COMPLETION_STATUS_KHR can be polled every frame. Without it, asking for the compile or link status blocks
+// until the work is done, so it is only asked while MayBlock is set (at load, and between frames in idle mode,
+// see main) and SHADER_COMPILE_GRACE after the submit, which lets drivers that compile in the background anyway
+// finish first.
+class ShaderCompiler
+{
+public:
+    bool Parallel = false;
+    bool MayBlock = true;   // without the extension: whether Finished may ask the blocking status query
+
+    static ShaderCompiler &Get()
+    {
+        static ShaderCompiler compiler;
+        return compiler;
+    }
+
+    // call once the context is current
+    void Init(GLADloadproc loader)
+    {
+        MaxThreadsProc maxThreads = nullptr;
+        if (HasGLExtension("GL_KHR_parallel_shader_compile"))
+            maxThreads = (MaxThreadsProc) loader("glMaxShaderCompilerThreadsKHR");
+        else if (HasGLExtension("GL_ARB_parallel_shader_compile"))
+            maxThreads = (MaxThreadsProc) loader("glMaxShaderCompilerThreadsARB");
+        if (maxThreads) {
+            maxThreads(0xFFFFFFFFu);   // as many threads as the driver likes
+            Parallel = true;
+        }
+    }
+
+    // true if polling Finished can make progress right now
+    bool Polls() const
+    {
+        return Parallel || MayBlock;
+    }
+
+    // true if the program's compile and link have finished; blocks only without the extension, only while
+    // MayBlock is set and only once SHADER_COMPILE_GRACE has passed since submitted
+    bool Finished(GLuint program, std::chrono::steady_clock::time_point submitted) const
+    {
+        if (!Parallel)
+            return MayBlock && std::chrono::steady_clock::now() - submitted >= SHADER_COMPILE_GRACE;
+        GLint done = GL_FALSE;
+        glGetProgramiv(program, GL_COMPLETION_STATUS_KHR, &done);
+        return done == GL_TRUE;
+    }
+
+private:
+    typedef void (APIENTRYP MaxThreadsProc)(GLuint count);
+
+    ShaderCompiler() = default;
+};
+#endif
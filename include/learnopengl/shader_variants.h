@@ -0,0 +1,170 @@
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/shader.h>
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Features a program can be specialized for; each one is a #define in the shared sources.
+enum Shader_Feature {
+    FEATURE_ALPHA_TEST       = 1 << 0,   // discards cut-out texels; from the mesh's material
+    FEATURE_POINT_LIGHT      = 1 << 1,   // the main point light (forward path); from the pass
+    FEATURE_CLUSTERED_LIGHTS = 1 << 2,   // every scene light through LightClusters; from the pass
+    FEATURE_ALPHA_BLEND      = 1 << 3    // outputs the texture's alpha for blending; from the mesh's material
+};
+
+const char *const SHADER_FEATURE_DEFINES[] = {"ALPHA_TEST", "POINT_LIGHT", "CLUSTERED_LIGHTS", "ALPHA_BLEND"};
+const int SHADER_FEATURE_COUNT = 4;
+// the bits a mesh contributes, the rest is the pass'
+const unsigned int MATERIAL_FEATURES = FEATURE_ALPHA_TEST | FEATURE_ALPHA_BLEND;
+
+
+// One pair of shader files compiled into a program per feature combination, so every draw runs code without the
+// branches and discards it does not need: opaque meshes get programs without discard, which keeps early depth
+// testing on. A mesh's features are fixed when its material is loaded (Mesh::Features); the pass sets Features,
+// and Get combines both.
+//
+// The variants seen at load time are compiled there with Warm. A combination first needed later is compiled in
+// the background, and Get returns nullptr (the draw is skipped) until it is ready, so no frame waits on the
+// compiler. Uniforms set through the variant set reach every ready program of the current pass.
+class ShaderVariants
+{
+public:
+    unsigned int Features = 0;   // pass features, combined with each mesh's material features
+    unsigned int IgnoredFeatures = 0;   // material features the pass does without, e.g. ALPHA_TEST after a depth prepass
+    // sets the uniforms a program needs once (sampler units, ...); run for every new program, also after a reload
+    std::function<void(Shader&)> Setup;
+
+    // supported: the features the sources know about, other bits are ignored
+    ShaderVariants(const char* vertexPath, const char* fragmentPath, unsigned int supported)
+        : vertexPath(vertexPath), fragmentPath(fragmentPath), supported(supported)
+    {
+    }
+
+    // compiles the variant for a material in the current pass now, at load time
+    void Warm(unsigned int materialFeatures)
+    {
+        variant(key(materialFeatures), COMPILE_BLOCKING);
+    }
+
+    // the program for a mesh with the given material features; nullptr while it is still compiling. A program
+    // that finished compiling is only handed out once BeginFrame promoted it, so every ForEach of the frame has
+    // given it the pass' uniforms.
+    Shader *Get(unsigned int materialFeatures)
+    {
+        Entry &entry = variant(key(materialFeatures), COMPILE_ASYNC);
+        return entry.SetUp ? entry.Program.get() : nullptr;
+    }
+
+    // promotes the programs that finished compiling, and swaps in finished reloads; call once per frame before the
+    // first ForEach, so no program starts to be handed out between two of them
+    void BeginFrame()
+    {
+        for (auto &variant : variants)
+            if (variant.second.Program->Ready())
+                prepare(variant.second);
+    }
+
+    // runs fn for every promoted program of the current pass, with the program in use
+    void ForEach(const std::function<void(Shader&)> &fn)
+    {
+        for (auto &variant : variants) {
+            if ((variant.first & ~MATERIAL_FEATURES) != key(0) || !variant.second.SetUp)
+                continue;
+            variant.second.Program->use();
+            fn(*variant.second.Program);
+        }
+    }
+
+    void setInt(const std::string &name, int value)
+    {
+        ForEach([&](Shader &shader) { shader.setInt(name, value); });
+    }
+    void setFloat(const std::string &name, float value)
+    {
+        ForEach([&](Shader &shader) { shader.setFloat(name, value); });
+    }
+    void setVec3(const std::string &name, const glm::vec3 &value)
+    {
+        ForEach([&](Shader &shader) { shader.setVec3(name, value); });
+    }
+    void setMat4(const std::string &name, const glm::mat4 &mat)
+    {
+        ForEach([&](Shader &shader) { shader.setMat4(name, mat); });
+    }
+
+    // see Shader::Reload, for every compiled variant
+    void Reload()
+    {
+        for (auto &variant : variants)
+            variant.second.Program->Reload();
+    }
+    // finishes the builds the driver is done with; true while any is still in flight
+    bool Building()
+    {
+        bool building = false;
+        for (auto &variant : variants) {
+            variant.second.Program->Ready();
+            building = building || variant.second.Program->Building();
+        }
+        return building;
+    }
+    unsigned int Count() const
+    {
+        return (unsigned int) variants.size();
+    }
+
+private:
+    struct Entry {
+        std::unique_ptr<Shader> Program;
+        bool SetUp = false;
+    };
+
+    std::string vertexPath, fragmentPath;
+    unsigned int supported;
+    std::map<unsigned int, Entry> variants;
+
+    // runs Setup on a ready program the first time
+    void prepare(Entry &entry)
+    {
+        if (!entry.SetUp) {
+            entry.SetUp = true;
+            if (Setup) {
+                entry.Program->use();
+                Setup(*entry.Program);
+            }
+        }
+    }
+
+    unsigned int key(unsigned int materialFeatures) const
+    {
+        return ((Features & ~MATERIAL_FEATURES) | (materialFeatures & MATERIAL_FEATURES & ~IgnoredFeatures)) & supported;
+    }
+
+    Entry &variant(unsigned int features, Shader_Compile compile)
+    {
+        Entry &entry = variants[features];
+        if (entry.Program)
+            return entry;
+        std::vector<std::string> defines;
+        for (int i = 0; i < SHADER_FEATURE_COUNT; i++)
+            if (features & (1u << i))
+                defines.push_back(SHADER_FEATURE_DEFINES[i]);
+        entry.Program.reset(new Shader(vertexPath.c_str(), fragmentPath.c_str(), defines, compile));
+        entry.Program->HoldBuilds = true;   // a reload swaps in at BeginFrame or Building, not in a use mid-frame
+        entry.Program->OnReload = [this](Shader &shader) {
+            if (Setup)
+                Setup(shader);
+        };
+        if (compile == COMPILE_BLOCKING)
+            prepare(entry);
+        return entry;
+    }
+};
+#endif
@@ -0,0 +1,222 @@
+#ifndef SHADOW_CASCADES_H
+#define SHADOW_CASCADES_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <learnopengl/resource_registry.h>
+#include <learnopengl/shader.h>
+#include <learnopengl/shader_variants.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <string>
+
+// Default shadow values
+const int SHADOW_CASCADES             = 4;
+const int SHADOW_MAP_SIZE             = 2048;
+const float SHADOW_DISTANCE           = 60.0f;   // receivers farther than this are unshadowed
+const float SHADOW_SPLIT_LAMBDA       = 0.75f;   // 0 = uniform splits, 1 = logarithmic splits
+const float SHADOW_CACHE_MARGIN       = 0.25f;   // extra cascade extent that lets the camera move without a re-render
+const float SHADOW_CASTER_RANGE       = 40.0f;   // how far towards the light casters are collected
+const int SHADOW_TEXTURE_UNIT         = 13;      // after the cluster buffers
+
+
+// Cascaded shadow maps for the directional light. The view frustum up to SHADOW_DISTANCE is split into
+// SHADOW_CASCADES slices; each slice is fitted with its bounding sphere, whose size does not change as the camera
+// turns, and the orthographic light box around it is snapped to whole shadow map texels, so the shadow edges do not
+// crawl while the camera moves.
+//
+// Every caster in the scene is static, so a cascade's map stays valid as long as its box still contains the
+// slice. Boxes are rendered SHADOW_CACHE_MARGIN larger than needed, and a cascade is re-rendered only when its
+// slice leaves the cached box, the light direction changes or InvalidateStatic() is called; a steady camera pays
+// for sampling only. The shaders pick the first cascade whose box contains the fragment.
+class ShadowCascades
+{
+public:
+    bool Enabled = true;
+    bool CacheEnabled = true;        // off: every cascade is refitted and re-rendered every frame
+    int RenderedCascades = 0;        // cascades re-rendered by the last Render, for the stats
+    unsigned int DepthTexture = 0;   // DEPTH_COMPONENT24 array, one layer per cascade
+    unsigned int FBO = 0;
+    glm::mat4 LightSpaceMatrices[SHADOW_CASCADES];
+
+    // the static casters changed; every cascade is re-rendered on the next frame
+    void InvalidateStatic()
+    {
+        for (int i = 0; i < SHADOW_CASCADES; i++)
+            cascades[i].Valid = false;
+    }
+
+    // fits the cascades to the camera and marks those whose cached map no longer covers their slice
+    void Update(const glm::mat4 &view, float fovY, float aspect, float nearPlane, const glm::vec3 &lightDirection)
+    {
+        if (FBO == 0)
+            create();
+
+        if (glm::length(lightDirection) < 1.0e-4f)
+            return;   // no direction to cast along, keep the last cascades
+        glm::vec3 direction = glm::normalize(lightDirection);
+        if (direction != cachedDirection) {
+            cachedDirection = direction;
+            glm::vec3 up = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+            lightView = glm::lookAt(glm::vec3(0.0f), direction, up);
+            InvalidateStatic();
+        }
+
+        glm::mat4 inverseView = glm::inverse(view);
+        float tanY = std::tan(fovY * 0.5f);
+        float tanX = tanY * aspect;
+        float farPlane = SHADOW_DISTANCE;
+        float sliceNear = nearPlane;
+        for (int i = 0; i < SHADOW_CASCADES; i++) {
+            // practical split scheme, a blend of logarithmic and uniform splits
+            float t = (float) (i + 1) / SHADOW_CASCADES;
+            float logSplit = nearPlane * std::pow(farPlane / nearPlane, t);
+            float uniformSplit = nearPlane + (farPlane - nearPlane) * t;
+            float sliceFar = SHADOW_SPLIT_LAMBDA * logSplit + (1.0f - SHADOW_SPLIT_LAMBDA) * uniformSplit;
+
+            // bounding sphere of the slice: on the view axis, equidistant from the near and far corners
+            float nearDiagonal2 = sliceNear * sliceNear * (tanX * tanX + tanY * tanY);
+            float farDiagonal2 = sliceFar * sliceFar * (tanX * tanX + tanY * tanY);
+            float centerDepth = 0.5f * (sliceNear + sliceFar) + 0.5f * (farDiagonal2 - nearDiagonal2) / (sliceFar - sliceNear);
+            centerDepth = std::min(centerDepth, sliceFar);
+            float radius = std::sqrt((sliceFar - centerDepth) * (sliceFar - centerDepth) + farDiagonal2);
+            radius = std::ceil(radius * 16.0f) / 16.0f;   // keep the texel size stable against float noise
+
+            glm::vec3 center = glm::vec3(lightView * inverseView * glm::vec4(0.0f, 0.0f, -centerDepth, 1.0f));
+            Cascade &cascade = cascades[i];
+            if (!CacheEnabled || !cascade.Valid || !cascade.Contains(center, radius))
+                fit(cascade, center, radius, CacheEnabled ? SHADOW_CACHE_MARGIN : 0.0f);
+            sliceNear = sliceFar;
+        }
+    }
+
+    // renders the casters into every cascade that Update marked; drawCasters(depthShader) draws the static casters
+    // with the variants' "model" uniform. The framebuffer and viewport are restored afterwards.
+    template<typename DrawCasters>
+    void Render(ShaderVariants &depthShader, DrawCasters drawCasters)
+    {
+        RenderedCascades = 0;
+        if (!Enabled)
+            return;
+
+        GLint previousFramebuffer, previousViewport[4];
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, previousViewport);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
+        glEnable(GL_POLYGON_OFFSET_FILL);
+        glPolygonOffset(2.0f, 4.0f);
+        for (int i = 0; i < SHADOW_CASCADES; i++) {
+            Cascade &cascade = cascades[i];
+            if (cascade.Valid)
+                continue;
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, DepthTexture, 0, i);
+            glClear(GL_DEPTH_BUFFER_BIT);
+            depthShader.setMat4("lightSpace", LightSpaceMatrices[i]);
+            drawCasters(depthShader);
+            cascade.Valid = true;
+            RenderedCascades++;
+        }
+        glDisable(GL_POLYGON_OFFSET_FILL);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+        glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+    }
+
+    // binds the shadow map and sets the cascade uniforms of a shader that samples ShadowFactor
+    void Bind(Shader &shader) const
+    {
+        shader.use();
+        shader.setInt("shadowsEnabled", Enabled);
+        shader.setInt("shadowMap", SHADOW_TEXTURE_UNIT);
+        for (int i = 0; i < SHADOW_CASCADES; i++)
+            shader.setMat4("lightSpaceMatrices[" + std::to_string(i) + "]", LightSpaceMatrices[i]);
+        glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, DepthTexture);
+        glActiveTexture(GL_TEXTURE0);
+    }
+
+    void Destroy()
+    {
+        if (FBO == 0)
+            return;
+        glDeleteFramebuffers(1, &FBO);
+        glDeleteTextures(1, &DepthTexture);
+        ResourceRegistry::Get().Untrack(RESOURCE_TEXTURE, DepthTexture);
+        FBO = 0;
+        DepthTexture = 0;
+    }
+
+private:
+    // the light-space box a cascade's map was rendered for
+    struct Cascade {
+        bool Valid = false;
+        glm::vec3 Min, Max;
+
+        bool Contains(const glm::vec3 &center, float radius) const
+        {
+            // casters up to SHADOW_CASTER_RANGE towards the light (+z in light view) must be inside as well
+            return center.x - radius >= Min.x && center.x + radius <= Max.x &&
+                   center.y - radius >= Min.y && center.y + radius <= Max.y &&
+                   center.z - radius >= Min.z && center.z + radius + SHADOW_CASTER_RANGE <= Max.z;
+        }
+    };
+
+    Cascade cascades[SHADOW_CASCADES];
+    glm::vec3 cachedDirection = glm::vec3(0.0f);
+    glm::mat4 lightView = glm::mat4(1.0f);
+
+    void fit(Cascade &cascade, const glm::vec3 &center, float radius, float margin)
+    {
+        float extent = radius * (1.0f + margin);
+        // snap the box to whole texels so a moving camera shifts the map by exact texels
+        float texel = 2.0f * extent / SHADOW_MAP_SIZE;
+        float x = std::floor(center.x / texel) * texel;
+        float y = std::floor(center.y / texel) * texel;
+        cascade.Min = glm::vec3(x - extent, y - extent, center.z - extent);
+        cascade.Max = glm::vec3(x + extent, y + extent, center.z + extent + SHADOW_CASTER_RANGE);
+        cascade.Valid = false;
+
+        int index = (int) (&cascade - cascades);
+        // the light looks down -z, so the depth range runs from -Max.z to -Min.z
+        LightSpaceMatrices[index] = glm::ortho(cascade.Min.x, cascade.Max.x, cascade.Min.y, cascade.Max.y,
+                                               -cascade.Max.z, -cascade.Min.z) * lightView;
+    }
+
+    void create()
+    {
+        glGenTextures(1, &DepthTexture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, DepthTexture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, SHADOW_CASCADES,
+                     0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+        ResourceRegistry::Get().Track(RESOURCE_TEXTURE, DepthTexture,
+                                      ResourceRegistry::TextureBytes(SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 4) * SHADOW_CASCADES,
+                                      "Shadow cascades");
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        // hardware depth comparison, filtered 2x2 by GL_LINEAR
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+        GLint previousFramebuffer;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, DepthTexture, 0, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::SHADOW_CASCADES:: Framebuffer is not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    }
+};
+#endif
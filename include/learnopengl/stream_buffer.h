@@ -0,0 +1,259 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include <glad/glad.h>
+
+#include <learnopengl/gl_extensions.h>
+#include <learnopengl/resource_registry.h>
+
+#include <algorithm>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+// GL 4.4 / ARB_buffer_storage, not part of the 3.3 core glad loader
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#endif
+#ifndef GL_MAP_COHERENT_BIT
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+// Default stream buffer values
+const size_t STREAM_BUFFER_SIZE      = (size_t) 4 << 20;
+const size_t STREAM_BUFFER_ALIGNMENT = 16;   // of every Map, the largest texel a buffer texture reads (RGBA32F)
+const size_t STREAM_BUFFER_MIN_TEXEL = 4;    // the smallest (R32UI), limits the size of the ring, see MaxSize
+
+
+// One ring buffer for the data that changes every frame (the light cluster lists, ...), so it is never
+// respecified with glBufferData / glBufferSubData, either of which may wait for draws still reading the old
+// contents. Maps follow each other through the ring; EndFrame puts a fence behind the frame's draws, and the space
+// of a frame is only handed out again once its fence has signaled.
+//
+// With GL 4.4 or ARB_buffer_storage the buffer is mapped once, persistent and coherent, and Map returns a pointer
+// into that mapping. On 3.3 Map maps just its range with GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT,
+// which the fences make safe, and Unmap unmaps it. Fences are only polled: when the ring is full of data the GPU
+// has not read yet, a buffer twice the size takes its place and the old one is deleted once the frame that used it
+// last is done, so the CPU never waits. Buffer() therefore has to be read after every Map.
+//
+// Buffer textures cover the whole ring, and GL only guarantees GL_MAX_TEXTURE_BUFFER_SIZE texels (65536 on 3.3) of
+// them, so the ring never grows past that many of its smallest texels. When a Map does not fit even then it
+// returns nullptr and the caller uploads its data some other way.
+class StreamBuffer
+{
+public:
+    bool Persistent = false;
+    size_t Size = 0;
+    unsigned int Grown = 0;   // times the ring was replaced by a larger one
+    size_t MaxSize = 0;       // largest ring every buffer texture can address
+    unsigned int Overflows = 0;   // Maps that did not fit
+
+    static StreamBuffer &Get()
+    {
+        static StreamBuffer stream;
+        return stream;
+    }
+
+    // loads glBufferStorage through the same loader as glad and creates the ring; call once the context is current
+    void Init(GLADloadproc loader)
+    {
+        bufferStorage = (BufferStorageProc) loader("glBufferStorage");
+        Persistent = bufferStorage && ((GLVersion.major == 4 && GLVersion.minor >= 4) || GLVersion.major > 4 ||
+                                       HasGLExtension("GL_ARB_buffer_storage"));
+        GLint maxTexels = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &maxTexels);
+        MaxSize = (size_t) std::max(maxTexels, 65536) * STREAM_BUFFER_MIN_TEXEL;
+        create(std::min(STREAM_BUFFER_SIZE, MaxSize));
+    }
+
+    unsigned int Buffer() const
+    {
+        return buffer;
+    }
+
+    // space for bytes; write them through the pointer, then call Unmap before drawing with them. offset receives
+    // where they are in Buffer(). nullptr when the ring is at MaxSize and has no room for them.
+    void *Map(size_t bytes, size_t &offset)
+    {
+        retire();
+        mappedBytes = 0;
+        size_t start = align(head);
+        size_t padding = start - head;
+        if (start + bytes > Size) {   // the rest of the ring is skipped, the data starts over at 0
+            padding = Size - head;
+            start = 0;
+        }
+        if (used + padding + bytes > Size) {
+            size_t size = std::min(std::max(Size * 2, align(bytes) * 2), MaxSize);
+            if (size <= Size || bytes > size) {
+                Overflows++;
+                return nullptr;
+            }
+            grow(size);
+            start = padding = 0;
+        }
+        head = start + bytes;
+        used += padding + bytes;
+        frameBytes += padding + bytes;
+        offset = start;
+        mappedOffset = start;
+        mappedBytes = bytes;
+
+        if (Persistent)
+            return mapped + start;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        void *range = glMapBufferRange(GL_COPY_WRITE_BUFFER, start, bytes,
+                                       GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        if (range)
+            return range;
+        staging.resize(bytes);   // Unmap uploads it
+        return staging.data();
+    }
+
+    void Unmap()
+    {
+        if (Persistent || mappedBytes == 0)
+            return;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        if (!staging.empty())
+            glBufferSubData(GL_COPY_WRITE_BUFFER, mappedOffset, mappedBytes, staging.data());
+        else if (glUnmapBuffer(GL_COPY_WRITE_BUFFER) != GL_TRUE)
+            std::cout << "ERROR::STREAM_BUFFER:: Mapped range was lost, one frame of stream data is undefined" << std::endl;
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        staging.clear();
+        mappedBytes = 0;
+    }
+
+    // fences the frame's data; call after the frame's last draw
+    void EndFrame()
+    {
+        for (Retired &old : retired)
+            if (!old.Fence)
+                old.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        if (frameBytes == 0)
+            return;
+        frames.push_back({glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), frameBytes});
+        frameBytes = 0;
+    }
+
+    // bytes the GPU may still read or this frame has written
+    size_t Used() const
+    {
+        return used;
+    }
+
+    void Destroy()
+    {
+        for (const Frame &frame : frames)
+            glDeleteSync(frame.Fence);
+        frames.clear();
+        for (const Retired &old : retired)
+            release(old.Buffer, old.Fence);
+        retired.clear();
+        if (buffer != 0)
+            release(buffer, 0);
+        buffer = 0;
+        mapped = nullptr;
+    }
+
+private:
+    typedef void (APIENTRYP BufferStorageProc)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+    // the data of a frame in flight, used bytes including what alignment and wrapping skipped
+    struct Frame {
+        GLsync Fence;
+        size_t Bytes;
+    };
+    // a buffer the ring outgrew; deleted when the fence behind its last frame signals
+    struct Retired {
+        unsigned int Buffer;
+        GLsync Fence;
+    };
+
+    BufferStorageProc bufferStorage = nullptr;
+    unsigned int buffer = 0;
+    unsigned char *mapped = nullptr;   // the persistent mapping
+    size_t head = 0;
+    size_t used = 0;
+    size_t frameBytes = 0;
+    size_t mappedOffset = 0, mappedBytes = 0;
+    std::vector<unsigned char> staging;
+    std::deque<Frame> frames;
+    std::vector<Retired> retired;
+
+    StreamBuffer() = default;
+
+    static size_t align(size_t offset)
+    {
+        return (offset + STREAM_BUFFER_ALIGNMENT - 1) & ~(STREAM_BUFFER_ALIGNMENT - 1);
+    }
+
+    static bool signaled(GLsync fence)
+    {
+        GLint status = GL_UNSIGNALED;
+        glGetSynciv(fence, GL_SYNC_STATUS, sizeof(status), nullptr, &status);
+        return status == GL_SIGNALED;
+    }
+
+    void create(size_t size)
+    {
+        Size = size;
+        head = used = frameBytes = 0;
+        glGenBuffers(1, &buffer);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+        if (Persistent) {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            bufferStorage(GL_COPY_WRITE_BUFFER, Size, nullptr, flags);
+            mapped = (unsigned char *) glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, Size, flags);
+            if (!mapped) {
+                std::cout << "ERROR::STREAM_BUFFER:: Persistent mapping failed, mapping every write instead" << std::endl;
+                glDeleteBuffers(1, &buffer);
+                glGenBuffers(1, &buffer);
+                glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+                Persistent = false;
+            }
+        }
+        if (!Persistent)
+            glBufferData(GL_COPY_WRITE_BUFFER, Size, nullptr, GL_STREAM_DRAW);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        ResourceRegistry::Get().Track(RESOURCE_BUFFER, buffer, Size, "Stream buffer");
+    }
+
+    // replaces the ring with one of size bytes; draws already submitted keep reading the old buffer until its
+    // last frame is done
+    void grow(size_t size)
+    {
+        for (const Frame &frame : frames)
+            glDeleteSync(frame.Fence);   // the retired buffer's own fence comes after all of them
+        frames.clear();
+        retired.push_back({buffer, 0});
+        Grown++;
+        create(size);
+    }
+
+    // frees the space of the frames the GPU is done with, in order, and deletes outgrown buffers
+    void retire()
+    {
+        while (!frames.empty() && signaled(frames.front().Fence)) {
+            glDeleteSync(frames.front().Fence);
+            used -= frames.front().Bytes;
+            frames.pop_front();
+        }
+        retired.erase(std::remove_if(retired.begin(), retired.end(), [this](const Retired &old) {
+            if (!old.Fence || !signaled(old.Fence))
+                return false;
+            release(old.Buffer, old.Fence);
+            return true;
+        }), retired.end());
+    }
+
+    void release(unsigned int old, GLsync fence)
+    {
+        if (fence)
+            glDeleteSync(fence);
+        glDeleteBuffers(1, &old);   // also ends a persistent mapping
+        ResourceRegistry::Get().Untrack(RESOURCE_BUFFER, old);
+    }
+};
+#endif
@@ -0,0 +1,400 @@
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+#include <stb_image.h>
+
+#include <learnopengl/mip_chain.h>
+#include <learnopengl/resource_registry.h>
+
+#include <algorithm>
+#include <cmath>
+#include <condition_variable>
+#include <deque>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Default texture streaming values
+const int STREAMING_RESIDENT_SIZE         = 128;         // mips this size and smaller are uploaded at load and kept
+const size_t STREAMING_BUDGET             = 128 << 20;   // bytes for the mips above the resident ones
+const unsigned int STREAMING_THREADS      = 2;
+const unsigned int STREAMING_MAX_IN_FLIGHT = 4;          // textures decoding at once
+const float STREAMING_NEAR_DISTANCE       = 0.1f;        // closest distance a surface is assumed to be at
+
+
+// Mip streaming for the model textures. Add uploads only the mips up to STREAMING_RESIDENT_SIZE and clamps the
+// texture to them with GL_TEXTURE_BASE_LEVEL; the finer mips are loaded once something asks for them.
+//
+// While the models are drawn, Model::RequestMips reports for every texture the finest mip its surfaces need, from
+// their distance to the camera, the screen's pixels per world unit and the mesh's texels per world unit (UV
+// density). Update then reads the missing levels on the streaming threads, from the MipChain cache (and the file
+// again for level 0), and uploads the result, one texture per frame, lowering the base level. The streamed levels
+// share STREAMING_BUDGET; when a load does not fit, the levels that were least recently needed are released first,
+// by raising their texture's base level and respecifying them empty.
+//
+// Sources are single level images (PNG, JPG), so a load of level 0 decodes the whole file.
+class TextureStreamer
+{
+public:
+    bool Enabled = true;          // false: Add is not used, textures are loaded with every mip (golden images)
+    size_t Budget = STREAMING_BUDGET;   // main lowers it to what the ResourceRegistry budget leaves
+    size_t ResidentBytes = 0;     // every mip of the streamed textures on the GPU
+    size_t StreamedBytes = 0;     // of them, the mips above the resident ones; counted against Budget
+    unsigned int Loads = 0;
+    unsigned int Evictions = 0;   // levels released to stay within Budget
+
+    static TextureStreamer &Get()
+    {
+        static TextureStreamer streamer;
+        return streamer;
+    }
+
+    // registers the bound GL_TEXTURE_2D texture, decoded from path into data, and uploads its resident mips
+    void Add(unsigned int id, const std::string &path, const unsigned char *data, int width, int height,
+             int components, GLenum format, GLenum internalFormat)
+    {
+        Streamed texture;
+        texture.Path = path;
+        texture.Width = width;
+        texture.Height = height;
+        texture.Components = components;
+        texture.Format = format;
+        texture.InternalFormat = internalFormat;
+        texture.SRGB = internalFormat == GL_SRGB || internalFormat == GL_SRGB_ALPHA;
+        texture.Levels = MipChain::LevelCount(width, height);
+        texture.ResidentBase = 0;
+        while (std::max(levelWidth(texture, texture.ResidentBase), levelHeight(texture, texture.ResidentBase)) >
+               STREAMING_RESIDENT_SIZE)
+            texture.ResidentBase++;
+        texture.TailBase = texture.ResidentBase;
+        texture.Wanted = texture.Levels;
+        texture.LastNeeded.assign(texture.Levels, 0);
+
+        MipChain chain;
+        chain.Generate(path, data, width, height, components, texture.SRGB);   // also fills the cache the loads read
+        chain.Upload(data, internalFormat, format, texture.TailBase);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.TailBase);
+        ResidentBytes += bytes(texture, texture.TailBase, texture.Levels);
+        textures[id] = texture;
+        track(id, texture);
+    }
+
+    // the camera the coming requests are measured against; call before the models are drawn
+    void BeginFrame(const glm::mat4 &view, float fovY, int viewportHeight)
+    {
+        glm::mat4 inverseView = glm::inverse(view);
+        cameraPosition = glm::vec3(inverseView[3]);
+        cameraFront = -glm::vec3(inverseView[2]);
+        pixelsPerUnit = (float) viewportHeight / (2.0f * std::tan(fovY * 0.5f));   // at distance 1
+    }
+
+    // a surface of texture id within radius of center, with uvPerUnit texture coordinates per world unit, is drawn
+    void Request(unsigned int id, const glm::vec3 &center, float radius, float uvPerUnit)
+    {
+        auto found = textures.find(id);
+        if (found == textures.end())
+            return;
+        glm::vec3 toCenter = center - cameraPosition;
+        if (glm::dot(toCenter, cameraFront) < -radius)
+            return;   // entirely behind the camera
+        Streamed &texture = found->second;
+        float distance = std::max(glm::length(toCenter) - radius, STREAMING_NEAR_DISTANCE);
+        float texelsPerPixel = uvPerUnit * std::max(texture.Width, texture.Height) * distance / pixelsPerUnit;
+        int level = texelsPerPixel > 1.0f ? (int) std::floor(std::log2(texelsPerPixel)) : 0;
+        texture.Wanted = std::min(texture.Wanted, std::min(level, texture.Levels - 1));
+    }
+
+    // finishes a decoded load, starts the loads the last frame's requests ask for and releases levels over budget
+    void Update()
+    {
+        frame++;
+        // stamped before anything is released, so levels the last frame's requests still need stay
+        for (auto &entry : textures) {
+            Streamed &texture = entry.second;
+            for (int level = std::max(texture.Wanted, 0); level < texture.Levels; level++)
+                texture.LastNeeded[level] = frame;
+        }
+        finishLoad();
+        if (!fits(0))
+            downscale();   // the budget was lowered below what the visible textures need
+
+        std::vector<unsigned int> missing;
+        for (auto &entry : textures)
+            if (entry.second.Wanted < entry.second.ResidentBase && !entry.second.Loading)
+                missing.push_back(entry.first);
+        // the textures furthest from what they need first
+        std::sort(missing.begin(), missing.end(), [this](unsigned int a, unsigned int b) {
+            const Streamed &ta = textures[a], &tb = textures[b];
+            return ta.ResidentBase - ta.Wanted > tb.ResidentBase - tb.Wanted;
+        });
+        for (unsigned int id : missing) {
+            if (inFlight >= STREAMING_MAX_IN_FLIGHT)
+                break;
+            Streamed &texture = textures[id];
+            int target = texture.Wanted;
+            while (target < texture.ResidentBase && !fits(bytes(texture, target, texture.ResidentBase)))
+                target++;   // coarser, if not even releasing the unneeded levels makes room
+            if (target < texture.ResidentBase)
+                startLoad(id, texture, target);
+        }
+
+        for (auto &entry : textures)
+            entry.second.Wanted = entry.second.Levels;
+    }
+
+    // loads started but not uploaded yet
+    unsigned int Pending() const
+    {
+        return inFlight;
+    }
+    unsigned int Count() const
+    {
+        return (unsigned int) textures.size();
+    }
+
+private:
+    struct Streamed {
+        std::string Path;
+        int Width, Height, Components;
+        GLenum Format, InternalFormat;
+        bool SRGB;
+        int Levels;
+        int TailBase;       // finest of the mips uploaded at load, never released
+        int ResidentBase;   // finest mip on the GPU, GL_TEXTURE_BASE_LEVEL
+        int Wanted;         // finest mip requested since the last Update
+        bool Loading = false;
+        std::vector<unsigned long long> LastNeeded;   // per level, the last frame it was requested
+    };
+
+    // a load for the streaming threads; Levels receives [Target, Until)
+    struct Load {
+        unsigned int ID;
+        Streamed Texture;
+        int Target, Until;
+        std::vector<std::vector<unsigned char>> Levels;
+    };
+
+    std::map<unsigned int, Streamed> textures;
+    glm::vec3 cameraPosition = glm::vec3(0.0f);
+    glm::vec3 cameraFront = glm::vec3(0.0f, 0.0f, -1.0f);
+    float pixelsPerUnit = 1.0f;
+    unsigned long long frame = 0;
+    unsigned int inFlight = 0;
+    size_t pendingBytes = 0;   // of the loads in flight, already counted against Budget
+
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::deque<Load> queued, finished;
+    bool stopping = false;
+
+    TextureStreamer()
+    {
+        for (unsigned int i = 0; i < STREAMING_THREADS; i++)
+            workers.emplace_back(&TextureStreamer::work, this);
+    }
+
+    ~TextureStreamer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    static int levelWidth(const Streamed &texture, int level)
+    {
+        return std::max(texture.Width >> level, 1);
+    }
+    static int levelHeight(const Streamed &texture, int level)
+    {
+        return std::max(texture.Height >> level, 1);
+    }
+    // GPU size of levels [first, until)
+    static size_t bytes(const Streamed &texture, int first, int until)
+    {
+        size_t total = 0;
+        for (int level = first; level < until; level++)
+            total += (size_t) levelWidth(texture, level) * levelHeight(texture, level) * texture.Components;
+        return total;
+    }
+
+    static void track(unsigned int id, const Streamed &texture)
+    {
+        ResourceRegistry::Get().Track(RESOURCE_TEXTURE, id, bytes(texture, texture.ResidentBase, texture.Levels),
+                                      texture.Path);
+    }
+
+    static void upload(const Streamed &texture, int level, const unsigned char *data)
+    {
+        glTexImage2D(GL_TEXTURE_2D, level, texture.InternalFormat, levelWidth(texture, level),
+                     levelHeight(texture, level), 0, texture.Format, GL_UNSIGNED_BYTE, data);
+    }
+
+    // true once size more bytes fit the budget, releasing levels no longer needed this frame if they have to go
+    bool fits(size_t size)
+    {
+        while (StreamedBytes + pendingBytes + size > Budget) {
+            Streamed *oldest = nullptr;
+            unsigned int oldestID = 0;
+            for (auto &entry : textures) {
+                Streamed &texture = entry.second;
+                if (texture.Loading || texture.ResidentBase >= texture.TailBase ||
+                    texture.LastNeeded[texture.ResidentBase] >= frame)
+                    continue;
+                if (!oldest || texture.LastNeeded[texture.ResidentBase] < oldest->LastNeeded[oldest->ResidentBase]) {
+                    oldest = &texture;
+                    oldestID = entry.first;
+                }
+            }
+            if (!oldest)
+                return false;
+            release(oldestID, *oldest);
+        }
+        return true;
+    }
+
+    // releases the largest streamed levels, needed or not, until the budget holds
+    void downscale()
+    {
+        while (StreamedBytes + pendingBytes > Budget) {
+            Streamed *largest = nullptr;
+            unsigned int largestID = 0;
+            for (auto &entry : textures) {
+                Streamed &texture = entry.second;
+                if (texture.Loading || texture.ResidentBase >= texture.TailBase)
+                    continue;
+                if (!largest || bytes(texture, texture.ResidentBase, texture.ResidentBase + 1) >
+                                bytes(*largest, largest->ResidentBase, largest->ResidentBase + 1)) {
+                    largest = &texture;
+                    largestID = entry.first;
+                }
+            }
+            if (!largest)
+                return;
+            release(largestID, *largest);
+        }
+    }
+
+    // drops the finest resident level of a texture
+    void release(unsigned int id, Streamed &texture)
+    {
+        int level = texture.ResidentBase++;
+        size_t size = bytes(texture, level, level + 1);
+        glBindTexture(GL_TEXTURE_2D, id);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, texture.ResidentBase);
+        glTexImage2D(GL_TEXTURE_2D, level, texture.InternalFormat, 0, 0, 0, texture.Format, GL_UNSIGNED_BYTE, NULL);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        StreamedBytes -= size;
+        ResidentBytes -= size;
+        Evictions++;
+        track(id, texture);
+    }
+
+    void startLoad(unsigned int id, Streamed &texture, int target)
+    {
+        texture.Loading = true;
+        inFlight++;
+        pendingBytes += bytes(texture, target, texture.ResidentBase);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            queued.push_back(Load{id, texture, target, texture.ResidentBase, {}});
+        }
+        wake.notify_one();
+    }
+
+    // uploads at most one finished load, so a frame pays for one texture's levels at most
+    void finishLoad()
+    {
+        Load load;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (finished.empty())
+                return;
+            load = std::move(finished.front());
+            finished.pop_front();
+        }
+        Streamed &texture = textures[load.ID];
+        size_t size = bytes(texture, load.Target, load.Until);
+        texture.Loading = false;
+        inFlight--;
+        pendingBytes -= size;
+        if (load.Levels.empty()) {
+            std::cout << "ERROR::TEXTURE_STREAMER:: Failed to reload " << texture.Path << std::endl;
+            textures.erase(load.ID);   // keeps the mips it has, without further requests
+            return;
+        }
+
+        glBindTexture(GL_TEXTURE_2D, load.ID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        for (int level = load.Target; level < load.Until; level++)
+            upload(texture, level, load.Levels[level - load.Target].data());
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, load.Target);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        texture.ResidentBase = load.Target;
+        StreamedBytes += size;
+        ResidentBytes += size;
+        Loads++;
+        track(load.ID, texture);
+    }
+
+    // fills load.Levels on a streaming thread; the chain is normally cached by Add, a missing cache file is rebuilt
+    // here without the ThreadPool, whose loops the render thread may be waiting on
+    static void read(Load &load)
+    {
+        const Streamed &texture = load.Texture;
+        MipChain chain;
+        bool cached = chain.Load(texture.Path, texture.Width, texture.Height, texture.Components, texture.SRGB);
+        unsigned char *data = nullptr;
+        if (!cached || load.Target == 0) {
+            int width, height, components;
+            data = stbi_load(texture.Path.c_str(), &width, &height, &components, texture.Components);
+            if (!data || width != texture.Width || height != texture.Height) {
+                stbi_image_free(data);
+                return;
+            }
+        }
+        if (!cached) {
+            chain.Build(data, texture.Width, texture.Height, texture.Components, texture.SRGB, false);
+            chain.Store(texture.Path);
+        }
+        for (int level = load.Target; level < load.Until; level++) {
+            if (level == 0)
+                load.Levels.emplace_back(data, data + bytes(texture, 0, 1));
+            else
+                load.Levels.push_back(std::move(chain.Levels[level - 1]));
+        }
+        stbi_image_free(data);
+    }
+
+    void work()
+    {
+        while (true) {
+            Load load;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [this] { return stopping || !queued.empty(); });
+                if (stopping)
+                    return;
+                load = std::move(queued.front());
+                queued.pop_front();
+            }
+            read(load);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                finished.push_back(std::move(load));
+            }
+        }
+    }
+};
+#endif
@@ -0,0 +1,123 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Default thread pool values
+const unsigned int MAX_POOL_THREADS = 8;
+
+
+// Worker threads shared by everything that splits CPU work per frame (light clustering, ...). Threads are created
+// once; ParallelFor hands out indices to the workers and to the calling thread and returns when all are done,
+// so a parallel loop costs a wake-up instead of a thread creation.
+class ThreadPool
+{
+public:
+    static ThreadPool &Get()
+    {
+        static ThreadPool pool;
+        return pool;
+    }
+
+    // threads taking part in ParallelFor, including the caller
+    unsigned int Size() const
+    {
+        return (unsigned int) workers.size() + 1;
+    }
+
+    // calls fn(index) for every index in [0, count); indices are claimed one at a time, so uneven work balances
+    void ParallelFor(unsigned int count, const std::function<void(unsigned int)> &fn)
+    {
+        if (count == 0)
+            return;
+        if (count == 1 || workers.empty()) {
+            for (unsigned int i = 0; i < count; i++)
+                fn(i);
+            return;
+        }
+
+        std::lock_guard<std::mutex> serial(callMutex);   // one loop at a time
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            job = &fn;
+            jobSize = count;
+            nextIndex = 0;
+            busyWorkers = (unsigned int) workers.size();
+            generation++;
+        }
+        wake.notify_all();
+        run(fn, count);
+
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [this] { return busyWorkers == 0; });
+        job = nullptr;
+    }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex callMutex;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const std::function<void(unsigned int)> *job = nullptr;
+    unsigned int jobSize = 0;
+    std::atomic<unsigned int> nextIndex;
+    unsigned int busyWorkers = 0;
+    unsigned long long generation = 0;
+    bool stopping = false;
+
+    ThreadPool() : nextIndex(0)
+    {
+        unsigned int threads = std::min(std::max(std::thread::hardware_concurrency(), 1u), MAX_POOL_THREADS);
+        for (unsigned int i = 1; i < threads; i++)
+            workers.emplace_back(&ThreadPool::work, this);
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread &worker : workers)
+            worker.join();
+    }
+
+    void run(const std::function<void(unsigned int)> &fn, unsigned int count)
+    {
+        for (unsigned int i = nextIndex++; i < count; i = nextIndex++)
+            fn(i);
+    }
+
+    void work()
+    {
+        unsigned long long seen = 0;
+        while (true) {
+            const std::function<void(unsigned int)> *current;
+            unsigned int count;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping)
+                    return;
+                seen = generation;
+                current = job;
+                count = jobSize;
+            }
+            run(*current, count);
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busyWorkers--;
+            }
+            done.notify_one();
+        }
+    }
+};
+#endif
@@ -1,2 +1,8 @@
+#include <learnopengl/linear_arena.h>
+
+// decoding scratch comes from the thread's current LinearArena during asset import, see linear_arena.h
+#define STBI_MALLOC(size)           ArenaMalloc(size)
+#define STBI_REALLOC(pointer, size) ArenaRealloc(pointer, size)
+#define STBI_FREE(pointer)          ArenaFree(pointer)
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
\ No newline at end of file
@@ -5,17 +5,8 @@ in vec3 FragPos;
 in vec3 Normal;
 in vec2 TexCoords;
 
-struct PointLight {
-    vec3 position;
-
-    vec3 specular;
-    vec3 diffuse;
-    vec3 ambient;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
+// PointLight and the cluster lists with ClusterRange / ClusterLight
+#include "clustered_lighting.glsl"
 
 struct DirLight{
     vec3 direction;
@@ -25,6 +16,7 @@ struct DirLight{
     vec3 ambient;
 };
 
+#ifdef SPOT_LIGHT
 struct SpotLight{
     vec3 position;
     vec3 direction;
@@ -41,6 +33,7 @@ struct SpotLight{
     vec3 ambient;
 
 };
+#endif
 
 struct Material {
     sampler2D diffuse;
@@ -49,30 +42,68 @@ struct Material {
     float shininess;
 };
 
+// the features this program is specialized for are #defined by ShaderVariants:
+// ALPHA_TEST discards cut-out texels, ALPHA_BLEND outputs the texture's alpha for the blended pass,
+// POINT_LIGHT lights with pointLight, CLUSTERED_LIGHTS with the cluster lists
+#ifdef POINT_LIGHT
 uniform PointLight pointLight;
+#endif
 uniform DirLight dirLight;
-//uniform SpotLight spotLight;
+#ifdef SPOT_LIGHT
+uniform SpotLight spotLight;
+#endif
 uniform Material material;
 uniform vec3 viewPosition;
 
+// ShadowFactor, AmbientLight and SkyReflection with their uniforms
+#include "scene_lighting.glsl"
+
+// the material, sampled once per fragment
+vec4 albedo;
+vec4 specularSample;
+
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir);
+#ifdef SPOT_LIGHT
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir);
+#endif
 
 void main()
 {
+    albedo = texture(material.diffuse, TexCoords);
+#if defined(ALPHA_BLEND)
+    // drawn back to front over the solid scene; only invisible texels are skipped
+    if (albedo.a < 0.01)
+        discard;
+#elif defined(ALPHA_TEST)
+    // before any lighting; opaque materials get a program without discard and keep early depth testing
+    if (albedo.a < 0.4)
+        discard;
+#endif
+    specularSample = texture(material.specular, TexCoords);
+
     vec3 norm = normalize(Normal);
     vec3 viewDir = normalize(viewPosition - FragPos);
 
     vec3 result = CalcDirLight(dirLight, norm, viewDir);
+    result += SkyReflection(norm, viewDir, material.shininess) * specularSample.rgb;
 
+#if defined(CLUSTERED_LIGHTS)
+    uvec2 range = ClusterRange(FragPos);
+    for (uint i = 0u; i < range.y; i++)
+        result += CalcPointLight(ClusterLight(range.x + i), norm, FragPos, viewDir);
+#elif defined(POINT_LIGHT)
     result += CalcPointLight(pointLight, norm, FragPos, viewDir);
-    //result += CalcSpotLight(spotLight, norm, FragPos, viewDir);
-    vec4 texColor = texture(material.diffuse, TexCoords);
-    if (texColor.a < 0.4)
-        discard;
-
+#endif
+#ifdef SPOT_LIGHT
+    result += CalcSpotLight(spotLight, norm, FragPos, viewDir);
+#endif
+
+#ifdef ALPHA_BLEND
+    FragColor = vec4(result, albedo.a);
+#else
     FragColor = vec4(result, 1.0);
+#endif
 }
 
 vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir){
@@ -84,11 +115,11 @@ vec3 CalcDirLight(DirLight light, vec3 normal, vec3 viewDir){
         vec3 halfwayDir = normalize(lightDir + viewDir);
         float spec = pow(max(dot(normal1, halfwayDir), 0.0), material.shininess);
 
-        vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-        vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-        vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords));
+        vec3 ambient = AmbientLight(normal, light.ambient) * albedo.rgb;
+        vec3 diffuse = light.diffuse * diff * albedo.rgb;
+        vec3 specular = light.specular * spec * specularSample.rgb;
 
-        return (ambient + diffuse + specular);
+        return (ambient + (diffuse + specular) * ShadowFactor(FragPos));
 }
 
 vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir){
@@ -104,19 +135,16 @@ vec3 CalcPointLight(PointLight light, vec3 normal, vec3 fragPos, vec3 viewDir){
         float distance = length(light.position - fragPos);
         float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
         // combine results
-        vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-        vec4 diffSample = texture(material.diffuse, TexCoords);
-        if (diffSample.a < 0.1){
-            discard;
-        }
-        vec3 diffuse = light.diffuse * diff * vec3(diffSample);
-        vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords).xxx);
+        vec3 ambient = light.ambient * albedo.rgb;
+        vec3 diffuse = light.diffuse * diff * albedo.rgb;
+        vec3 specular = light.specular * spec * specularSample.xxx;
         ambient *= attenuation;
         diffuse *= attenuation;
         specular *= attenuation;
         return (ambient + diffuse + specular);
 }
 
+#ifdef SPOT_LIGHT
 vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir){
 
         vec3 lightDir = normalize(light.position - fragPos);
@@ -132,13 +160,14 @@ vec3 CalcSpotLight(SpotLight light, vec3 normal, vec3 fragPos, vec3 viewDir){
         float epsilon = light.cutOff - light.outerCutOff;
         float intensity = clamp((theta - light.outerCutOff) / epsilon, 0.0, 1.0);
 
-        vec3 ambient = light.ambient * vec3(texture(material.diffuse, TexCoords));
-        vec3 diffuse = light.diffuse * diff * vec3(texture(material.diffuse, TexCoords));
-        vec3 specular = light.specular * spec * vec3(texture(material.specular, TexCoords).xxx);
+        vec3 ambient = light.ambient * albedo.rgb;
+        vec3 diffuse = light.diffuse * diff * albedo.rgb;
+        vec3 specular = light.specular * spec * specularSample.xxx;
 
         ambient *= attenuation * intensity;
         diffuse *= attenuation * intensity;
         specular *= attenuation * intensity;
 
         return (ambient + diffuse + specular);
-}
\ No newline at end of file
+}
+#endif
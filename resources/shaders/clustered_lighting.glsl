@@ -0,0 +1,56 @@
+// The point light struct and the cluster lists of LightClusters, shared by 2.model_lighting.fs, river.fs and
+// heatmap.fs, included by Shader after their #version line and defines.
+
+struct PointLight {
+    vec3 position;
+
+    vec3 ambient;
+    vec3 diffuse;
+    vec3 specular;
+
+    float constant;
+    float linear;
+    float quadratic;
+
+    float radius;   // only set by ClusterLight: the distance the light reaches, see LightRadius
+};
+
+// clustered lighting, the lists are built by LightClusters
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer clusterLightIndices;
+uniform samplerBuffer clusterLights;
+uniform ivec3 clusterBase;   // first texel of this frame's grid, indices and lights in the stream buffer
+uniform vec3 clusterDims;
+uniform vec2 clusterViewport;
+uniform float clusterNear;
+uniform float clusterFar;
+uniform mat4 view;
+
+// offset and length of the light list of the cluster this fragment is in
+uvec2 ClusterRange(vec3 fragPos){
+    float depth = -(view * vec4(fragPos, 1.0)).z;
+    vec3 cell = vec3(gl_FragCoord.xy / clusterViewport, log(max(depth, clusterNear) / clusterNear) / log(clusterFar / clusterNear));
+    ivec3 cluster = ivec3(clamp(cell * clusterDims, vec3(0.0), clusterDims - 1.0));
+    int index = (cluster.z * int(clusterDims.y) + cluster.y) * int(clusterDims.x) + cluster.x;
+    return texelFetch(clusterGrid, clusterBase.x + index).rg;
+}
+
+// the light at listIndex of the index list, see ClusterRange
+PointLight ClusterLight(uint listIndex){
+    int base = clusterBase.z + int(texelFetch(clusterLightIndices, clusterBase.y + int(listIndex)).r) * 4;
+    vec4 texel0 = texelFetch(clusterLights, base);
+    vec4 texel1 = texelFetch(clusterLights, base + 1);
+    vec4 texel2 = texelFetch(clusterLights, base + 2);
+    vec4 texel3 = texelFetch(clusterLights, base + 3);
+
+    PointLight light;
+    light.position = texel0.xyz;
+    light.constant = texel0.w;
+    light.ambient = texel1.rgb;
+    light.linear = texel1.w;
+    light.diffuse = texel2.rgb;
+    light.quadratic = texel2.w;
+    light.specular = texel3.rgb;
+    light.radius = texel3.w;
+    return light;
+}
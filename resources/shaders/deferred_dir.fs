@@ -0,0 +1,51 @@
+#version 330 core
+out vec4 FragColor;
+
+struct DirLight{
+    vec3 direction;
+
+    vec3 specular;
+    vec3 diffuse;
+    vec3 ambient;
+};
+
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+uniform vec2 viewportSize;
+
+uniform DirLight dirLight;
+uniform vec3 viewPosition;
+uniform float shininess;
+
+// ShadowFactor, AmbientLight and SkyReflection with their uniforms
+#include "scene_lighting.glsl"
+
+
+// ambient and directional light for every covered pixel, same terms as CalcDirLight in 2.model_lighting.fs
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    if (depth == 1.0)
+        discard;
+
+    vec4 ndc = vec4(gl_FragCoord.xy / viewportSize * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec4 world = inverseViewProjection * ndc;
+    vec3 fragPos = world.xyz / world.w;
+    vec4 albedoSpec = texelFetch(gAlbedoSpec, pixel, 0);
+    vec3 normal = texelFetch(gNormal, pixel, 0).rgb;
+    vec3 viewDir = normalize(viewPosition - fragPos);
+
+    vec3 lightDir = normalize(-dirLight.direction);
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
+
+    vec3 ambient = AmbientLight(normal, dirLight.ambient) * albedoSpec.rgb;
+    vec3 diffuse = dirLight.diffuse * diff * albedoSpec.rgb;
+    vec3 specular = dirLight.specular * spec * albedoSpec.a;
+    vec3 reflection = SkyReflection(normal, viewDir, shininess) * albedoSpec.a;
+    FragColor = vec4(ambient + (diffuse + specular) * ShadowFactor(fragPos) + reflection, 1.0);
+}
@@ -0,0 +1,50 @@
+#version 330 core
+out vec4 FragColor;
+
+struct PointLight {
+    vec3 position;
+
+    vec3 specular;
+    vec3 diffuse;
+    vec3 ambient;
+
+    float constant;
+    float linear;
+    float quadratic;
+};
+
+uniform sampler2D gAlbedoSpec;
+uniform sampler2D gNormal;
+uniform sampler2D gDepth;
+uniform mat4 inverseViewProjection;
+uniform vec2 viewportSize;
+
+uniform PointLight light;
+uniform vec3 viewPosition;
+uniform float shininess;
+
+// one point light, drawn with its light volume and added to what is already there; same terms as
+// CalcPointLight in 2.model_lighting.fs
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    vec4 ndc = vec4(gl_FragCoord.xy / viewportSize * 2.0 - 1.0, depth * 2.0 - 1.0, 1.0);
+    vec4 world = inverseViewProjection * ndc;
+    vec3 fragPos = world.xyz / world.w;
+    vec4 albedoSpec = texelFetch(gAlbedoSpec, pixel, 0);
+    vec3 normal = texelFetch(gNormal, pixel, 0).rgb;
+    vec3 viewDir = normalize(viewPosition - fragPos);
+
+    vec3 lightDir = normalize(light.position - fragPos);
+    float diff = max(dot(normal, lightDir), 0.0);
+    vec3 halfwayDir = normalize(lightDir + viewDir);
+    float spec = pow(max(dot(normal, halfwayDir), 0.0), shininess);
+    float distance = length(light.position - fragPos);
+    float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * (distance * distance));
+
+    vec3 ambient = light.ambient * albedoSpec.rgb;
+    vec3 diffuse = light.diffuse * diff * albedoSpec.rgb;
+    vec3 specular = light.specular * spec * albedoSpec.a;
+    FragColor = vec4((ambient + diffuse + specular) * attenuation, 1.0);
+}
\ No newline at end of file
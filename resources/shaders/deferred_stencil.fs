@@ -0,0 +1,6 @@
+#version 330 core
+
+// stencil marking of light volumes, no color output
+void main()
+{
+}
\ No newline at end of file
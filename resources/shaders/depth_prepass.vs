@@ -0,0 +1,19 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+uniform mat4 model;
+uniform mat4 view;
+uniform mat4 projection;
+
+// exactly the transform of 2.model_lighting.vs, so the lit pass finds the depth written here GL_EQUAL
+invariant gl_Position;
+
+void main()
+{
+    vec3 fragPos = vec3(model * vec4(aPos, 1.0));
+    TexCoords = aTexCoords;
+    gl_Position = projection * view * vec4(fragPos, 1.0);
+}
\ No newline at end of file
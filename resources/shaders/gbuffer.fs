@@ -0,0 +1,29 @@
+#version 330 core
+layout (location = 0) out vec4 gAlbedoSpec;
+layout (location = 1) out vec3 gNormal;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+
+    float shininess;
+};
+
+uniform Material material;
+
+// geometry pass of the deferred path: the surface attributes 2.model_lighting.fs would light
+void main()
+{
+    vec4 texColor = texture(material.diffuse, TexCoords);
+#ifdef ALPHA_TEST
+    if (texColor.a < 0.4)
+        discard;
+#endif
+
+    gAlbedoSpec = vec4(texColor.rgb, texture(material.specular, TexCoords).r);
+    gNormal = normalize(Normal);
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+in vec2 TexCoords;
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+
+    float shininess;
+};
+
+uniform Material material;
+uniform int debugView;   // Debug_View
+
+const int DEBUG_VIEW_LIGHT_COUNT = 2;
+const int DEBUG_VIEW_MIP_LEVEL = 3;
+
+// the cluster lists of LightClusters, built for the light count view whatever the render path
+#include "clustered_lighting.glsl"
+
+float LightCount(vec3 fragPos);
+float MipLevel(sampler2D sampler, vec2 texCoords);
+
+// the value of this fragment for DebugViews; every view but overdraw adds 1 so 0 stays "no model here"
+void main()
+{
+#ifdef ALPHA_TEST
+    if (texture(material.diffuse, TexCoords).a < 0.4)
+        discard;
+#endif
+    float value = 1.0;
+    if (debugView == DEBUG_VIEW_LIGHT_COUNT)
+        value = LightCount(FragPos) + 1.0;
+    else if (debugView == DEBUG_VIEW_MIP_LEVEL)
+        value = MipLevel(material.diffuse, TexCoords) + 1.0;
+    FragColor = vec4(value, 0.0, 0.0, 1.0);
+}
+
+// lights of the fragment's cluster whose radius reaches it
+float LightCount(vec3 fragPos){
+        uvec2 range = ClusterRange(fragPos);
+        float count = 0.0;
+        for (uint i = 0u; i < range.y; i++) {
+            PointLight light = ClusterLight(range.x + i);
+            if (distance(light.position, fragPos) < light.radius)
+                count += 1.0;
+        }
+        return count;
+}
+
+// the level the hardware picks for a trilinear lookup, from the texel footprint of the pixel
+float MipLevel(sampler2D sampler, vec2 texCoords){
+        vec2 size = vec2(textureSize(sampler, 0));
+        vec2 dx = dFdx(texCoords * size);
+        vec2 dy = dFdy(texCoords * size);
+        float level = 0.5 * log2(max(dot(dx, dx), dot(dy, dy)));
+        return clamp(level, 0.0, floor(log2(max(size.x, size.y))));
+}
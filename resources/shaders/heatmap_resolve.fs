@@ -0,0 +1,22 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D values;   // DebugViews::ValueTexture
+uniform float bias;         // subtracted from covered pixels, see heatmap.fs
+uniform float range;        // the value shown as the hottest color
+
+// blue through green and yellow to red
+vec3 Heat(float t){
+        return clamp(vec3(1.5 - abs(4.0 * t - 3.0), 1.5 - abs(4.0 * t - 2.0), 1.5 - abs(4.0 * t - 1.0)), 0.0, 1.0);
+}
+
+void main()
+{
+    float value = texelFetch(values, ivec2(gl_FragCoord.xy), 0).r;
+    if (value <= 0.0) {
+        // no model here
+        FragColor = vec4(0.05, 0.05, 0.05, 1.0);
+        return;
+    }
+    FragColor = vec4(Heat(clamp((value - bias) / range, 0.0, 1.0)), 1.0);
+}
\ No newline at end of file
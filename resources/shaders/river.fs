@@ -24,13 +24,22 @@ uniform vec3 viewPos;
 uniform Material material;
 uniform Light light;
 
+uniform bool clustered;   // lit by the cluster lists too
+// PointLight and the cluster lists with ClusterRange / ClusterLight
+#include "clustered_lighting.glsl"
+
+// ShadowFactor, AmbientLight and SkyReflection with their uniforms
+#include "scene_lighting.glsl"
+
+vec3 CalcPointLight(PointLight pointLight, vec3 normal, vec3 fragPos, vec3 viewDir);
+
 void main()
 {
     // ambient
-    vec3 ambient = light.ambient * texture(material.diffuse, TexCoords).rgb;
+    vec3 norm = normalize(Normal);
+    vec3 ambient = AmbientLight(norm, light.ambient) * texture(material.diffuse, TexCoords).rgb;
 
     // diffuse
-    vec3 norm = normalize(Normal);
     // vec3 lightDir = normalize(light.position - FragPos);
     vec3 lightDir = normalize(-light.direction);
     float diff = max(dot(norm, lightDir), 0.0);
@@ -42,6 +51,27 @@ void main()
     float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
     vec3 specular = light.specular * spec * texture(material.specular, TexCoords).rgb;
 
-    vec3 result = ambient + diffuse + specular;
+    vec3 result = ambient + (diffuse + specular) * ShadowFactor(FragPos);
+    result += SkyReflection(norm, viewDir, material.shininess) * texture(material.specular, TexCoords).rgb;
+    if (clustered) {
+        uvec2 range = ClusterRange(FragPos);
+        for (uint i = 0u; i < range.y; i++)
+            result += CalcPointLight(ClusterLight(range.x + i), norm, FragPos, viewDir);
+    }
     FragColor = vec4(result, 1.0);
-}
\ No newline at end of file
+}
+
+// same lighting model as the directional light above
+vec3 CalcPointLight(PointLight pointLight, vec3 normal, vec3 fragPos, vec3 viewDir){
+        vec3 lightDir = normalize(pointLight.position - fragPos);
+        float diff = max(dot(normal, lightDir), 0.0);
+        vec3 reflectDir = reflect(-lightDir, normal);
+        float spec = pow(max(dot(viewDir, reflectDir), 0.0), material.shininess);
+        float distance = length(pointLight.position - fragPos);
+        float attenuation = 1.0 / (pointLight.constant + pointLight.linear * distance + pointLight.quadratic * (distance * distance));
+
+        vec3 ambient = pointLight.ambient * texture(material.diffuse, TexCoords).rgb;
+        vec3 diffuse = pointLight.diffuse * diff * texture(material.diffuse, TexCoords).rgb;
+        vec3 specular = pointLight.specular * spec * texture(material.specular, TexCoords).rgb;
+        return (ambient + diffuse + specular) * attenuation;
+}
@@ -0,0 +1,59 @@
+// Shadow and sky lighting shared by the lit shaders (2.model_lighting.fs, deferred_dir.fs, river.fs), included by
+// Shader after their #version line and defines.
+
+// cascaded shadow maps of the directional light, rendered by ShadowCascades
+uniform bool shadowsEnabled;
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 lightSpaceMatrices[4];
+
+// image based lighting from the skybox, baked by ImageBasedLighting
+uniform bool iblEnabled;
+uniform float iblIntensity;
+uniform float iblMaxLod;
+uniform vec3 iblSH[9];
+uniform samplerCube iblPrefiltered;
+uniform sampler2D iblBrdfLut;
+
+// fraction of the directional light reaching fragPos, from the first (finest) cascade whose box contains it
+float ShadowFactor(vec3 fragPos){
+    if (!shadowsEnabled)
+        return 1.0;
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    for (int i = 0; i < 4; i++) {
+        vec4 lightSpace = lightSpaceMatrices[i] * vec4(fragPos, 1.0);
+        vec3 coords = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+        if (any(lessThan(coords.xy, texel * 2.0)) || any(greaterThan(coords.xy, 1.0 - texel * 2.0)) || coords.z > 1.0)
+            continue;
+        // 3x3 taps of the hardware filtered comparison
+        float lit = 0.0;
+        for (int x = -1; x <= 1; x++)
+            for (int y = -1; y <= 1; y++)
+                lit += texture(shadowMap, vec4(coords.xy + vec2(x, y) * texel, float(i), coords.z - 0.0005));
+        return lit / 9.0;
+    }
+    return 1.0;
+}
+
+// diffuse light from the sky reaching a surface facing normal, or the flat ambient when IBL is off
+vec3 AmbientLight(vec3 normal, vec3 flatAmbient){
+    if (!iblEnabled)
+        return flatAmbient;
+    vec3 n = normalize(normal);
+    vec3 irradiance = iblSH[0] * 0.282095
+                    + iblSH[1] * 0.488603 * n.y + iblSH[2] * 0.488603 * n.z + iblSH[3] * 0.488603 * n.x
+                    + iblSH[4] * 1.092548 * n.x * n.y + iblSH[5] * 1.092548 * n.y * n.z
+                    + iblSH[6] * 0.315392 * (3.0 * n.z * n.z - 1.0)
+                    + iblSH[7] * 1.092548 * n.x * n.z + iblSH[8] * 0.546274 * (n.x * n.x - n.y * n.y);
+    return max(irradiance, vec3(0.0)) * iblIntensity;
+}
+
+// reflected sky, split-sum approximation for a dielectric whose roughness matches the Blinn-Phong shininess
+vec3 SkyReflection(vec3 normal, vec3 viewDir, float shininess){
+    if (!iblEnabled)
+        return vec3(0.0);
+    vec3 n = normalize(normal);
+    float roughness = pow(2.0 / (shininess + 2.0), 0.25);
+    vec3 prefiltered = textureLod(iblPrefiltered, reflect(-viewDir, n), roughness * iblMaxLod).rgb;
+    vec2 brdf = texture(iblBrdfLut, vec2(max(dot(n, viewDir), 0.0), roughness)).rg;
+    return prefiltered * (0.04 * brdf.x + brdf.y) * iblIntensity;
+}
@@ -0,0 +1,22 @@
+#version 330 core
+in vec2 TexCoords;
+
+struct Material {
+    sampler2D diffuse;
+    sampler2D specular;
+
+    float shininess;
+};
+
+uniform Material material;
+
+// depth only, for the shadow maps and the depth prepass; the leaves cut out of their quads by 2.model_lighting.fs
+// must not cast solid shadows or occlude, opaque materials get the ALPHA_TEST-free variant that writes depth without
+// sampling
+void main()
+{
+#ifdef ALPHA_TEST
+    if (texture(material.diffuse, TexCoords).a < 0.4)
+        discard;
+#endif
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+
+uniform mat4 model;
+uniform mat4 lightSpace;
+
+void main()
+{
+    TexCoords = aTexCoords;
+    gl_Position = lightSpace * model * vec4(aPos, 1.0);
+}
\ No newline at end of file
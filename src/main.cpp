@@ -13,14 +13,38 @@
 #include <learnopengl/shader.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
+#include <learnopengl/frame_pacer.h>
+#include <learnopengl/idle_monitor.h>
+#include <learnopengl/dynamic_resolution.h>
+#include <learnopengl/profiler.h>
+#include <learnopengl/render_stats.h>
+#include <learnopengl/benchmark.h>
+#include <learnopengl/input_recorder.h>
+#include <learnopengl/golden_image.h>
+#include <learnopengl/frame_capture.h>
+#include <learnopengl/lights.h>
+#include <learnopengl/render_path.h>
+#include <learnopengl/deferred_renderer.h>
+#include <learnopengl/light_clusters.h>
+#include <learnopengl/shadow_cascades.h>
+#include <learnopengl/image_based_lighting.h>
+#include <learnopengl/debug_views.h>
+#include <learnopengl/texture_streamer.h>
+#include <learnopengl/resource_registry.h>
+#include <learnopengl/mip_chain.h>
+#include <learnopengl/stream_buffer.h>
 
 #include <iostream>
+#include <climits>
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height);
 void mouse_callback(GLFWwindow *window, double xpos, double ypos);
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset);
-void processInput(GLFWwindow *window);
+InputStep processInput(GLFWwindow *window);
+void applyInput(const InputStep &step, float timestep);
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods);
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods);
+void window_refresh_callback(GLFWwindow *window);
 unsigned int loadTexture(const char *path);
 unsigned int loadTextureParallax(const char *path, bool gammaCorrection);
 unsigned int loadCubemap(vector<std::string> faces);
@@ -30,44 +54,44 @@ void renderQuad();
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 float heightScale = 0.02;
+int framebufferWidth = SCR_WIDTH;   // actual size of the default framebuffer, follows window resizes
+int framebufferHeight = SCR_HEIGHT;
 
 // camera
 
 float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
+// mouse input gathered by the callbacks, consumed by the next simulation step
+float pendingMouseX = 0.0f;
+float pendingMouseY = 0.0f;
+float pendingScroll = 0.0f;
+bool shaderReloadRequested = false;   // F5, handled at the start of the next frame
 
 // timing
-float deltaTime = 0.0f;
-float lastFrame = 0.0f;
-
-struct PointLight{
-    glm::vec3 position;
-
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-
-    float constant;
-    float linear;
-    float quadratic;
-};
-
-struct DirLight{
-    glm::vec3 direction;
-
-    glm::vec3 ambient;
-    glm::vec3 diffuse;
-    glm::vec3 specular;
-};
+const float FIXED_TIMESTEP = 1.0f / 120.0f; // simulation step, independent of the frame rate
+float deltaTime = 0.0f;                     // duration of the last rendered frame
+double accumulator = 0.0;                   // frame time not yet consumed by simulation steps
 
 struct ProgramState {
     glm::vec3 clearColor = glm::vec3(0);
     bool ImGuiEnabled = false;
+    bool IdleRenderingEnabled = true;
+    Render_Path RenderPath = RENDER_FORWARD;
+    int SceneLightCount = 0;     // fireflies on top of the main point light
+    bool DepthPrepass = false;   // forward paths: depth first, then lighting only for the visible fragments
     Camera camera;
     bool CameraMouseMovementUpdateEnabled = true;
     PointLight pointLight;
     DirLight dirLight;
+    FramePacer framePacer;
+    IdleMonitor idleMonitor;
+    DynamicResolution dynamicResolution;
+    LightClusters lightClusters;
+    ShadowCascades shadows;
+    ImageBasedLighting ibl;
+    FrameCapture frameCapture;
+    DebugViews debugViews;
     ProgramState()
             : camera(glm::vec3(0.0f, 0.0f, 3.0f)) {}
 
@@ -87,12 +111,21 @@ void ProgramState::SaveToFile(std::string filename) {
         << camera.Position.z << '\n'
         << camera.Front.x << '\n'
         << camera.Front.y << '\n'
-        << camera.Front.z << '\n';
+        << camera.Front.z << '\n'
+        << framePacer.Mode << '\n'
+        << framePacer.TargetFps << '\n'
+        << IdleRenderingEnabled << '\n'
+        << dynamicResolution.Enabled << '\n'
+        << dynamicResolution.TargetMs << '\n'
+        << RenderPath << '\n'
+        << SceneLightCount << '\n'
+        << DepthPrepass << '\n';
 }
 
 void ProgramState::LoadFromFile(std::string filename) {
     std::ifstream in(filename);
     if (in) {
+        glm::vec3 front = camera.Front;
         in >> clearColor.r
            >> clearColor.g
            >> clearColor.b
@@ -100,20 +133,72 @@ void ProgramState::LoadFromFile(std::string filename) {
            >> camera.Position.x
            >> camera.Position.y
            >> camera.Position.z
-           >> camera.Front.x
-           >> camera.Front.y
-           >> camera.Front.z;
+           >> front.x
+           >> front.y
+           >> front.z;
+        // Yaw and Pitch too, mouse input and input recordings continue from them
+        camera.SetFront(front);
+        int pacingMode;
+        if (in >> pacingMode >> framePacer.TargetFps)
+            framePacer.Mode = (Frame_Pacing) pacingMode;
+        in >> IdleRenderingEnabled
+           >> dynamicResolution.Enabled
+           >> dynamicResolution.TargetMs;
+        int renderPath;
+        if (in >> renderPath >> SceneLightCount)
+            RenderPath = (Render_Path) renderPath;
+        in >> DepthPrepass;
+        camera.PreviousPosition = camera.Position;
     }
 }
 
 ProgramState *programState;
 
+// a mesh of a blended material, drawn back to front after everything solid
+struct BlendedDraw {
+    Mesh *Object;
+    glm::mat4 Model;
+    GLenum CullFace;
+    float Depth;   // view space distance of the mesh's center, set when the list is sorted
+};
+
 void DrawImGui(ProgramState *programState);
 
-int main() {
+int main(int argc, char **argv) {
+    // --benchmark renders a scripted camera path offscreen and reports frame times instead of running interactively
+    BenchmarkOptions benchmark;
+    benchmark.ParseArguments(argc, argv);
+    // --record writes the input of every simulation step to a file, --replay plays such a file back
+    std::string recordPath, replayPath;
+    for (int i = 1; i + 1 < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--record")
+            recordPath = argv[++i];
+        else if (arg == "--replay")
+            replayPath = argv[++i];
+    }
+    // --golden renders canonical views offscreen and compares them against stored reference images
+    GoldenTest golden;
+    golden.ParseArguments(argc, argv);
+    bool offscreen = benchmark.Enabled || golden.Enabled;
+
     // glfw: initialize and configure
     // ------------------------------
-    glfwInit();
+    // the null platform has no native context API, OSMesa renders in its place
+    bool nullPlatform = false;
+    if (benchmark.Headless) {
+#ifdef GLFW_PLATFORM_NULL
+        glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+        nullPlatform = true;
+#else
+        std::cout << "Headless mode needs GLFW 3.4, falling back to a hidden window" << std::endl;
+#endif
+    }
+    if (!glfwInit()) {
+        std::cout << "Failed to initialize GLFW" << (benchmark.Headless ? "" : ", is a display available? --headless needs none")
+                  << std::endl;
+        return -1;
+    }
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
@@ -121,10 +206,20 @@ int main() {
 #ifdef __APPLE__
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
+    if (offscreen)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    if (benchmark.UseEGL)
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    if (nullPlatform)
+        glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
 
     // glfw window creation
     // --------------------
-    GLFWwindow *window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
+    GLFWwindow *window = golden.Enabled
+            ? glfwCreateWindow(golden.Width, golden.Height, "LearnOpenGL", NULL, NULL)
+            : benchmark.Enabled
+            ? glfwCreateWindow(benchmark.Width, benchmark.Height, "LearnOpenGL", NULL, NULL)
+            : glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "LearnOpenGL", NULL, NULL);
     if (window == NULL) {
         std::cout << "Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -135,6 +230,9 @@ int main() {
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetScrollCallback(window, scroll_callback);
     glfwSetKeyCallback(window, key_callback);
+    glfwSetMouseButtonCallback(window, mouse_button_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
+    glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
     // tell GLFW to capture our mouse
     glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
 
@@ -144,12 +242,26 @@ int main() {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    ProgramCache::Get().Init((GLADloadproc) glfwGetProcAddress);
+    ShaderCompiler::Get().Init((GLADloadproc) glfwGetProcAddress);
+    StreamBuffer::Get().Init((GLADloadproc) glfwGetProcAddress);
 
     // tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
     //stbi_set_flip_vertically_on_load(true);
 
     programState = new ProgramState;
-    programState->LoadFromFile("resources/program_state.txt");
+    if (offscreen) {
+        // fixed settings instead of the saved state, so runs are comparable
+        programState->framePacer.Mode = PACING_UNCAPPED;
+        programState->IdleRenderingEnabled = false;
+        programState->dynamicResolution.Enabled = !golden.Enabled;
+        programState->dynamicResolution.Adaptive = false;
+        programState->DepthPrepass = benchmark.DepthPrepass;
+        if (!benchmark.DebugView.empty() && !DebugViews::FromKey(benchmark.DebugView, programState->debugViews.View))
+            std::cout << "ERROR::BENCHMARK:: Unknown debug view " << benchmark.DebugView << std::endl;
+    } else {
+        programState->LoadFromFile("resources/program_state.txt");
+    }
     if (programState->ImGuiEnabled) {
         glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
     }
@@ -170,31 +282,71 @@ int main() {
 
     // blending
     // -----
-    glEnable(GL_BLEND);
+    // off by default; only the passes that blend (grass, blended materials) turn it on
     glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 
     // build and compile shaders
     // -------------------------
-    Shader ourShader("resources/shaders/2.model_lighting.vs", "resources/shaders/2.model_lighting.fs");
+    // one program per material and pass feature combination, see ShaderVariants
+    ShaderVariants ourShader("resources/shaders/2.model_lighting.vs", "resources/shaders/2.model_lighting.fs",
+                             FEATURE_ALPHA_TEST | FEATURE_POINT_LIGHT | FEATURE_CLUSTERED_LIGHTS | FEATURE_ALPHA_BLEND);
+    ourShader.Setup = LightClusters::SetupShader;
     Shader parallaxMapping("resources/shaders/parallax_mapping.vs", "resources/shaders/parallex_mapping.fs");
     Shader skyboxShader("resources/shaders/skybox.vs", "resources/shaders/skybox.fs");
     Shader riverShader("resources/shaders/river.vs", "resources/shaders/river.fs");
     Shader grassShader("resources/shaders/grass.vs", "resources/shaders/grass.fs");
-
+    ShaderVariants gBufferShader("resources/shaders/2.model_lighting.vs", "resources/shaders/gbuffer.fs",
+                                 FEATURE_ALPHA_TEST);
+    Shader deferredDirShader("resources/shaders/deferred_quad.vs", "resources/shaders/deferred_dir.fs");
+    Shader deferredPointShader("resources/shaders/deferred_volume.vs", "resources/shaders/deferred_point.fs");
+    Shader deferredStencilShader("resources/shaders/deferred_volume.vs", "resources/shaders/deferred_stencil.fs");
+    ShaderVariants shadowDepthShader("resources/shaders/shadow_depth.vs", "resources/shaders/shadow_depth.fs",
+                                     FEATURE_ALPHA_TEST);
+    ShaderVariants depthPrepassShader("resources/shaders/depth_prepass.vs", "resources/shaders/shadow_depth.fs",
+                                      FEATURE_ALPHA_TEST);
+    ShaderVariants heatmapShader("resources/shaders/2.model_lighting.vs", "resources/shaders/heatmap.fs",
+                                 FEATURE_ALPHA_TEST);
+    heatmapShader.Setup = LightClusters::SetupShader;
+    Shader heatmapResolveShader("resources/shaders/deferred_quad.vs", "resources/shaders/heatmap_resolve.fs");
 
     // load models
     // -----------
-    Model tree("resources/objects/tree/scene.gltf");
-    tree.SetShaderTextureNamePrefix("material.");
-
-    Model bridge("resources/objects/bridge/scene.gltf");
-    bridge.SetShaderTextureNamePrefix("material.");
-
-    Model cottage("resources/objects/house/scene.gltf");
-    cottage.SetShaderTextureNamePrefix("material.");
-
-    Model trees("resources/objects/trees/scene.gltf");
-    trees.SetShaderTextureNamePrefix("material.");
+    // golden images compare every mip from the first frame on, the other runs stream the large ones in
+    TextureStreamer::Get().Enabled = !golden.Enabled;
+    Model tree, bridge, cottage, trees;
+    Model::LoadAll({{&tree, "resources/objects/tree/scene.gltf"},
+                    {&bridge, "resources/objects/bridge/scene.gltf"},
+                    {&cottage, "resources/objects/house/scene.gltf"},
+                    {&trees, "resources/objects/trees/scene.gltf"}});
+    for (Model* loaded : {&tree, &bridge, &cottage, &trees})
+        loaded->SetShaderTextureNamePrefix("material.");
+
+    // compile the variants the scene's materials need in both forward passes now rather than mid-frame; blended
+    // meshes get their ALPHA_BLEND programs, with and without the alpha test a depth prepass drops
+    unsigned int opaqueMeshes = 0, maskedMeshes = 0, blendedMeshes = 0;
+    for (Model* loaded : {&tree, &bridge, &cottage, &trees}) {
+        for (Mesh& mesh : loaded->meshes) {
+            opaqueMeshes += mesh.Alpha == ALPHA_OPAQUE;
+            maskedMeshes += mesh.Alpha == ALPHA_MASKED;
+            blendedMeshes += mesh.Alpha == ALPHA_BLENDED;
+            for (unsigned int passFeatures : {FEATURE_POINT_LIGHT, FEATURE_CLUSTERED_LIGHTS}) {
+                ourShader.Features = passFeatures;
+                for (unsigned int ignored : {0u, (unsigned int) FEATURE_ALPHA_TEST}) {
+                    ourShader.IgnoredFeatures = ignored;
+                    ourShader.Warm(mesh.Features);
+                }
+            }
+            gBufferShader.Warm(mesh.Features);
+            shadowDepthShader.Warm(mesh.Features);
+            depthPrepassShader.Warm(mesh.Features);
+        }
+    }
+    std::cout << "Meshes: " << opaqueMeshes << " opaque, " << maskedMeshes << " masked, " << blendedMeshes << " blended"
+              << std::endl;
+    ProgramCache& programCache = ProgramCache::Get();
+    if (programCache.Enabled)
+        std::cout << "Program cache: " << programCache.Hits << " loaded, "
+                  << programCache.Misses + programCache.Rejected << " compiled" << std::endl;
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
@@ -421,6 +573,13 @@ int main() {
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
 
+    ResourceRegistry& registry = ResourceRegistry::Get();
+    registry.Track(RESOURCE_BUFFER, grassVBO, sizeof(grassVertices), "Grass vertices");
+    registry.Track(RESOURCE_BUFFER, grassEBO, sizeof(grassIndices), "Grass indices");
+    registry.Track(RESOURCE_BUFFER, riverVBO, sizeof(riverVertices), "River vertices");
+    registry.Track(RESOURCE_BUFFER, riverEBO, sizeof(riverIndices), "River indices");
+    registry.Track(RESOURCE_BUFFER, skyboxVBO, sizeof(skyboxVertices), "Skybox vertices");
+
     // load textures
     // -------------
 
@@ -446,12 +605,24 @@ int main() {
 
             };
     unsigned int cubemapTexture = loadCubemap(faces);
+    programState->ibl.Load(faces);
 
     // shader configuration
     // --------------------
     riverShader.use();
     riverShader.setInt("material.diffuse", 0);
     riverShader.setInt("material.specular", 1);
+    LightClusters::SetupShader(riverShader);
+    // F5 rebuilds the programs in the background; these restore what the new programs would miss
+    riverShader.OnReload = [](Shader &shader) {
+        shader.setInt("material.diffuse", 0);
+        shader.setInt("material.specular", 1);
+        LightClusters::SetupShader(shader);
+    };
+    std::vector<Shader*> reloadableShaders = {&skyboxShader, &riverShader, &grassShader, &deferredDirShader,
+                                             &deferredPointShader, &deferredStencilShader, &heatmapResolveShader};
+    std::vector<ShaderVariants*> reloadableVariants = {&ourShader, &gBufferShader, &shadowDepthShader,
+                                                       &depthPrepassShader, &heatmapShader};
 
     // point light config
     PointLight& pointLight = programState->pointLight;
@@ -477,61 +648,373 @@ int main() {
     // draw in wireframe
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
+    CameraPath cameraPath;
+    BenchmarkReport benchmarkReport;
+    unsigned int benchmarkFrame = 0;
+
+    PboReadback readback;
+    unsigned int goldenFrame = 0;
+    auto checkGolden = [&golden](ReadbackImage &image) { golden.Check(image); };
+
+    InputRecorder inputRecorder;
+    InputReplay inputReplay;
+    if (!replayPath.empty())
+        inputReplay.Open(replayPath, programState->camera);
+    if (!recordPath.empty())
+        inputRecorder.Start(recordPath, programState->camera, FIXED_TIMESTEP);
+
+    // the main point light followed by the scene lights; rebuilt when the light count changes
+    std::vector<PointLight> pointLights;
+    DeferredRenderer deferredRenderer;
+
+    // every lit model of the scene with the face culling it needs; drawn by the forward and the deferred path.
+    // depthOnly draws the meshes' depth streams, for the shadow maps and the depth prepass. Only meshes of the
+    // alphaClasses (Material_Alpha bits) are drawn; with blended set, blended meshes are appended to it instead.
+    auto drawModels = [&](ShaderVariants &shader, bool depthOnly, unsigned int alphaClasses,
+                          std::vector<BlendedDraw> *blended) {
+        glm::mat4 model;
+        GLenum cullFace = GL_FRONT;
+        auto draw = [&](Model &drawn) {
+            unsigned int drawnClasses = alphaClasses;
+            if (blended) {
+                drawnClasses &= ~ALPHA_BLENDED;
+                for (Mesh &mesh : drawn.meshes)
+                    if (mesh.Alpha & alphaClasses & ALPHA_BLENDED)
+                        blended->push_back({&mesh, model, cullFace, 0.0f});
+            }
+            if (depthOnly)
+                drawn.DrawDepth(shader, drawnClasses);
+            else {
+                drawn.RequestMips(model);
+                drawn.Draw(shader, drawnClasses);
+            }
+        };
+        glEnable(GL_CULL_FACE);
+        glCullFace(cullFace);
+
+        {
+            PROFILE_GPU_SCOPE("Trees");
+            //trees
+            model = glm::mat4(1.0f);
+            model = glm::translate(model,glm::vec3(-7.0f, -1.01f, -7.0f));
+            model = glm::scale(model, glm::vec3(0.30f));
+            model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+            shader.setMat4("model", model);
+            draw(tree);
+
+
+            model = glm::mat4(1.0f);
+            model = glm::translate(model,glm::vec3(3.0f, -1.01f, -5.0f));
+            model = glm::scale(model, glm::vec3(0.30f));
+            model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+            model = glm::rotate(model, glm::radians(-45.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+            shader.setMat4("model", model);
+            draw(tree);
+
+
+            model = glm::mat4(1.0f);
+            model = glm::translate(model,glm::vec3(10.0f, -1.01f, -7.0f));
+            model = glm::scale(model, glm::vec3(0.22f));
+            model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+            shader.setMat4("model", model);
+            draw(tree);
+        }
+
+        cullFace = GL_BACK;
+        glCullFace(cullFace);
+
+        {
+            PROFILE_GPU_SCOPE("Bridge");
+            model = glm::mat4(1.0f);
+            model = glm::translate(model,glm::vec3(-3.0f, -0.55f, -1.5f));
+            model = glm::scale(model, glm::vec3(0.4f));
+            model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+            shader.setMat4("model", model);
+            draw(bridge);
+        }
+
+        {
+            PROFILE_GPU_SCOPE("Cottage");
+            model = glm::mat4(1.0f);
+            model = glm::translate(model,glm::vec3(-3.0f, -1.01f, -9.0f));
+            model = glm::scale(model, glm::vec3(0.0035f));
+            shader.setMat4("model", model);
+            draw(cottage);
+        }
+
+        {
+            PROFILE_GPU_SCOPE("Background trees");
+            //background trees
+            for(int i = 0; i<4; i++){
+                model = glm::mat4(1.0f);
+                model = glm::translate(model,glm::vec3(-12.0f + i*7.0f, -1.01f, -12.0f));
+                model = glm::scale(model, glm::vec3(0.08f - i * 0.01 ));
+                model = glm::rotate(model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+                model = glm::rotate(model, glm::radians(i*15.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+                shader.setMat4("model", model);
+                draw(trees);
+
+                model = glm::mat4(1.0f);
+                model = glm::translate(model,glm::vec3(-12.0f, -1.01f, -12.0f + i*7.0f));
+                model = glm::scale(model, glm::vec3(0.08f - i * 0.01));
+                model = glm::rotate(model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+                model = glm::rotate(model, glm::radians(i*15.0f), glm::vec3(0.0f, 0.0f, 1.0f));
+                shader.setMat4("model", model);
+                draw(trees);
+            }
+        }
+
+        glDisable(GL_CULL_FACE);
+    };
+
+    // draws the collected blended meshes back to front with blending on and depth writes off
+    std::vector<BlendedDraw> blendedDraws;
+    auto drawBlended = [&](ShaderVariants &shader, const glm::mat4 &view) {
+        for (BlendedDraw &draw : blendedDraws)
+            draw.Depth = -(view * draw.Model * glm::vec4(draw.Object->Center, 1.0f)).z;
+        std::sort(blendedDraws.begin(), blendedDraws.end(),
+                  [](const BlendedDraw &a, const BlendedDraw &b) { return a.Depth > b.Depth; });
+        glEnable(GL_BLEND);
+        glDepthMask(GL_FALSE);
+        glEnable(GL_CULL_FACE);
+        for (BlendedDraw &draw : blendedDraws) {
+            Shader *program = shader.Get(draw.Object->Features);
+            if (!program)
+                continue;
+            program->use();
+            program->setMat4("model", draw.Model);
+            glCullFace(draw.CullFace);
+            draw.Object->Draw(*program);
+        }
+        glCullFace(GL_BACK);
+        glDisable(GL_CULL_FACE);
+        glDepthMask(GL_TRUE);
+        glDisable(GL_BLEND);
+    };
+
     // render loop
     // -----------
+    // swaps in the programs whose builds finished; returns how many are still in flight
+    auto pollShaderBuilds = [&]() {
+        unsigned int building = 0;
+        for (Shader* shader : reloadableShaders) {
+            shader->Ready();   // also the programs this frame does not use
+            building += shader->Building();
+        }
+        for (ShaderVariants* variants : reloadableVariants)
+            building += variants->Building();
+        return building;
+    };
+
     while (!glfwWindowShouldClose(window)) {
         // per-frame time logic
         // --------------------
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+        FramePacer& framePacer = programState->framePacer;
+        IdleMonitor& idleMonitor = programState->idleMonitor;
+        ShaderCompiler& compiler = ShaderCompiler::Get();
+        // without parallel compile the status query blocks; in idle mode it is only asked between frames
+        compiler.MayBlock = !programState->IdleRenderingEnabled;
+        // nothing changed since the last presented frame: keep showing it and sleep until input arrives
+        if (programState->IdleRenderingEnabled && !idleMonitor.ShouldRender()) {
+            double timeout = IDLE_WAIT_TIMEOUT;
+            unsigned int building = compiler.Parallel ? 0 : pollShaderBuilds();
+            if (building > 0) {
+                compiler.MayBlock = true;
+                unsigned int left = pollShaderBuilds();
+                compiler.MayBlock = false;
+                if (left < building)
+                    idleMonitor.RequestRedraw();   // show the new programs
+                timeout = left < building ? 0.0 : std::chrono::duration<double>(SHADER_COMPILE_GRACE).count();
+            }
+            glfwWaitEventsTimeout(timeout);
+            framePacer.Resume();
+            continue;
+        }
+        PROFILE_BEGIN_FRAME();
+        PROFILE_GPU_SCOPE("Frame");
+
+        if (shaderReloadRequested) {
+            shaderReloadRequested = false;
+            for (Shader* shader : reloadableShaders)
+                shader->Reload();
+            for (ShaderVariants* variants : reloadableVariants)
+                variants->Reload();
+        }
+        if (pollShaderBuilds() > 0 && compiler.Polls())
+            idleMonitor.RequestRedraw();   // keep polling until every new program is in use
+        for (ShaderVariants* variants : reloadableVariants)
+            variants->BeginFrame();   // the variants this frame hands out, before any of their uniforms are set
+        double frameStart = glfwGetTime();
+        RenderStats::Get().Reset();
+        framePacer.Apply();
+        double frameTime = framePacer.BeginFrame();
+        deltaTime = frameTime;
+        accumulator += frameTime;
 
         // input
         // -----
-        processInput(window);
+        // the simulation advances in fixed steps; rendering interpolates between the last two of them
+        float alpha;
+        if (inputReplay.Active()) {
+            // recorded input advances a fixed number of steps per frame, independent of the wall clock, so every
+            // replay renders exactly the same frames; benchmark warm-up frames do not consume any
+            PROFILE_SCOPE("Replay");
+            unsigned int steps = benchmark.Enabled && benchmarkFrame < BENCHMARK_WARMUP_FRAMES ? 0 : REPLAY_STEPS_PER_FRAME;
+            InputStep step;
+            for (unsigned int i = 0; i < steps && inputReplay.Next(step); i++) {
+                programState->camera.PreviousPosition = programState->camera.Position;
+                applyInput(step, inputReplay.Timestep);
+            }
+            alpha = 1.0f;
+            if (inputReplay.Active())
+                idleMonitor.RequestRedraw();   // steps only advance in rendered frames, also while the camera holds still
+            else
+                std::cout << "Input replay finished" << std::endl;
+            if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+                glfwSetWindowShouldClose(window, true);
+        } else if (benchmark.Enabled && !replayPath.empty()) {
+            // the replay ended: the benchmark covers exactly the recorded frames
+            break;
+        } else if (golden.Enabled) {
+            // canonical views, each held for a few frames before it is read back
+            if (!golden.ApplyView(programState->camera, goldenFrame))
+                break;
+            alpha = 1.0f;
+        } else if (benchmark.Enabled) {
+            // scripted camera; warm-up frames stay at the start of the path
+            int measuredFrame = (int) benchmarkFrame - (int) BENCHMARK_WARMUP_FRAMES;
+            cameraPath.Apply(programState->camera, std::max(measuredFrame, 0) / (float) std::max(benchmark.Frames - 1, 1u));
+            alpha = 1.0f;
+        } else {
+            PROFILE_SCOPE("Simulation");
+            while (accumulator >= FIXED_TIMESTEP) {
+                programState->camera.PreviousPosition = programState->camera.Position;
+                InputStep step = processInput(window);
+                inputRecorder.Record(step);
+                applyInput(step, FIXED_TIMESTEP);
+                accumulator -= FIXED_TIMESTEP;
+            }
+            alpha = accumulator / FIXED_TIMESTEP;
+        }
+
+        // everything the image depends on besides input events; a change keeps the loop rendering
+        const float observedState[] = {
+                programState->camera.Position.x, programState->camera.Position.y, programState->camera.Position.z,
+                programState->camera.PreviousPosition.x, programState->camera.PreviousPosition.y, programState->camera.PreviousPosition.z,
+                programState->camera.Front.x, programState->camera.Front.y, programState->camera.Front.z,
+                programState->camera.Zoom,
+                programState->clearColor.r, programState->clearColor.g, programState->clearColor.b,
+                (float) programState->ImGuiEnabled
+        };
+        idleMonitor.Observe(observedState, sizeof(observedState));
 
 
         // render
         // ------
+        // the scene goes into the (possibly downscaled) offscreen target, ImGui later draws at native resolution
+        DynamicResolution& dynamicResolution = programState->dynamicResolution;
+        dynamicResolution.Resize(framebufferWidth, framebufferHeight);
+        dynamicResolution.Begin();
+        float aspect = (float) dynamicResolution.Width / (float) dynamicResolution.Height;
+
         glClearColor(programState->clearColor.r, programState->clearColor.g, programState->clearColor.b, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // view/projection/model
-        glm::mat4 view = programState->camera.GetViewMatrix();
-        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        glm::mat4 view = programState->camera.GetViewMatrix(alpha);
+        glm::mat4 projection = glm::perspective(glm::radians(programState->camera.Zoom), aspect, 0.1f, 100.0f);
         glm::mat4 model = glm::mat4(1.0f);
+        TextureStreamer& textureStreamer = TextureStreamer::Get();
+        textureStreamer.BeginFrame(view, glm::radians(programState->camera.Zoom), dynamicResolution.RenderHeight);
 
+        if (pointLights.size() != (size_t) programState->SceneLightCount + 1) {
+            pointLights = ScatterPointLights(programState->SceneLightCount);
+            pointLights.insert(pointLights.begin(), pointLight);
+        }
+        pointLights[0] = pointLight;
 
+        // the pass features of the forward programs; set before any of their uniforms
+        ourShader.Features = programState->RenderPath == RENDER_CLUSTERED ? FEATURE_CLUSTERED_LIGHTS : FEATURE_POINT_LIGHT;
+        // behind a depth prepass, fragments the alpha test would discard fail the GL_EQUAL depth test instead
+        ourShader.IgnoredFeatures = programState->DepthPrepass ? FEATURE_ALPHA_TEST : 0;
+
+        ShadowCascades& shadows = programState->shadows;
+        {
+            PROFILE_GPU_SCOPE("Shadows");
+            shadows.Update(view, glm::radians(programState->camera.Zoom), aspect, 0.1f, dirLight.direction);
+            // blended meshes cast the shadow of their alpha tested texels
+            shadows.Render(shadowDepthShader, [&](ShaderVariants &shader) {
+                drawModels(shader, true, ALPHA_ALL, nullptr);
+            });
+        }
+        ourShader.ForEach([&](Shader &shader) {
+            shadows.Bind(shader);
+            programState->ibl.Bind(shader);
+        });
+        shadows.Bind(riverShader);
+        shadows.Bind(deferredDirShader);
+        programState->ibl.Bind(riverShader);
+        programState->ibl.Bind(deferredDirShader);
+
+        DebugViews& debugViews = programState->debugViews;
+        LightClusters& lightClusters = programState->lightClusters;
+        if (programState->RenderPath == RENDER_CLUSTERED || debugViews.View == DEBUG_VIEW_LIGHT_COUNT) {
+            PROFILE_SCOPE("Light clusters");
+            lightClusters.Build(view, glm::radians(programState->camera.Zoom), aspect, 0.1f, 100.0f, pointLights);
+        }
+        if (programState->RenderPath == RENDER_CLUSTERED) {
+            ourShader.ForEach([&](Shader &shader) {
+                lightClusters.Bind(shader, dynamicResolution.RenderWidth, dynamicResolution.RenderHeight);
+            });
+            lightClusters.Bind(riverShader, dynamicResolution.RenderWidth, dynamicResolution.RenderHeight);
+        } else {
+            riverShader.use();
+            riverShader.setInt("clustered", 0);
+        }
+
+        if (programState->RenderPath == RENDER_DEFERRED) {
+            PROFILE_GPU_SCOPE("Deferred");
+            deferredRenderer.Resize(dynamicResolution.Width, dynamicResolution.Height);
+            {
+                PROFILE_GPU_SCOPE("G-buffer");
+                deferredRenderer.BeginGeometry(programState->clearColor);
+                gBufferShader.setMat4("projection", projection);
+                gBufferShader.setMat4("view", view);
+                glDepthFunc(GL_LEQUAL);
+                drawModels(gBufferShader, false, ALPHA_OPAQUE | ALPHA_MASKED, nullptr);
+                glDepthFunc(GL_LESS);
+            }
+            {
+                PROFILE_GPU_SCOPE("Lights");
+                deferredRenderer.Lighting(deferredDirShader, deferredPointShader, deferredStencilShader, view, projection,
+                                          programState->camera.Position, 32.0f, dirLight, pointLights);
+                deferredRenderer.Resolve();
+            }
+        }
+
+        {
+            PROFILE_GPU_SCOPE("River");
+            // draw river
+            riverShader.use();
+            riverShader.setVec3("light.direction", dirLight.direction);
+            riverShader.setVec3("viewPos", programState->camera.Position);
+            riverShader.setVec3("light.ambient", dirLight.ambient);
+            riverShader.setVec3("light.diffuse", dirLight.diffuse);
+            riverShader.setVec3("light.specular", dirLight.specular);
+            riverShader.setFloat("material.shininess", 32.0f);
+            riverShader.setMat4("projection", projection);
+            riverShader.setMat4("view", view);
+            model = glm::mat4(1.0f);
+            riverShader.setMat4("model", model);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, riverTexture);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, riverTextureSpec);
+            glBindVertexArray(riverVAO);
+            glDrawElements(GL_TRIANGLES, 52*3, GL_UNSIGNED_INT, 0);
+            RenderStats::Get().AddDraw(52*3);
+        }
 
-        // graw grass
-        grassShader.use();
-        grassShader.setMat4("projection", projection);
-        grassShader.setMat4("view", view);
-        model = glm::mat4(1.0f);
-        grassShader.setMat4("model", model);
-        glBindVertexArray(grassVAO);
-        glBindTexture(GL_TEXTURE_2D, grassTexture);
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-
-
-        // draw river
-        riverShader.use();
-        riverShader.setVec3("light.direction", dirLight.direction);
-        riverShader.setVec3("viewPos", programState->camera.Position);
-        riverShader.setVec3("light.ambient", dirLight.ambient);
-        riverShader.setVec3("light.diffuse", dirLight.diffuse);
-        riverShader.setVec3("light.specular", dirLight.specular);
-        riverShader.setFloat("material.shininess", 32.0f);
-        riverShader.setMat4("projection", projection);
-        riverShader.setMat4("view", view);
-        model = glm::mat4(1.0f);
-        riverShader.setMat4("model", model);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, riverTexture);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, riverTextureSpec);
-        glBindVertexArray(riverVAO);
-        glDrawElements(GL_TRIANGLES, 52*3, GL_UNSIGNED_INT, 0);
 /*
         // parallax mapping
         // ----------------
@@ -590,139 +1073,250 @@ int main() {
 
         glDisable(GL_CULL_FACE);
 */
-        ourShader.use();
-
-        view = programState->camera.GetViewMatrix();
-        projection = glm::perspective(glm::radians(programState->camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        model = glm::mat4(1.0f);
-
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-
-        // directional Light
-        ourShader.setVec3("dirLight.direction", dirLight.direction);
-        ourShader.setVec3("dirLight.ambient", dirLight.ambient);
-        ourShader.setVec3("dirLight.diffuse", dirLight.diffuse);
-        ourShader.setVec3("dirLight.specular", dirLight.specular);
-
-
-        // point light
-        ourShader.setVec3("pointLight.position", pointLight.position);
-        ourShader.setVec3("pointLight.ambient", pointLight.ambient);
-        ourShader.setVec3("pointLight.diffuse", pointLight.diffuse);
-        ourShader.setVec3("pointLight.specular", pointLight.specular);
-        ourShader.setFloat("pointLight.constant", pointLight.constant);
-        ourShader.setFloat("pointLight.linear", pointLight.linear);
-        ourShader.setFloat("pointLight.quadratic", pointLight.quadratic);
-
-        ourShader.setVec3("viewPosition", programState->camera.Position);
-        ourShader.setFloat("material.shininess", 32.0f);
-
-        // view/projection transformations
-        projection = glm::perspective(glm::radians(programState->camera.Zoom),
-                                      (float) SCR_WIDTH / (float) SCR_HEIGHT, 0.1f, 100.0f);
-        view = programState->camera.GetViewMatrix();
-        ourShader.setMat4("projection", projection);
-        ourShader.setMat4("view", view);
-
-        glDepthFunc(GL_LEQUAL);
-
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_FRONT);
-
-        //trees
-        model = glm::mat4(1.0f);
-        model = glm::translate(model,glm::vec3(-7.0f, -1.01f, -7.0f));
-        model = glm::scale(model, glm::vec3(0.30f));
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        ourShader.setMat4("model", model);
-        tree.Draw(ourShader);
-
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model,glm::vec3(3.0f, -1.01f, -5.0f));
-        model = glm::scale(model, glm::vec3(0.30f));
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        model = glm::rotate(model, glm::radians(-45.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-        ourShader.setMat4("model", model);
-        tree.Draw(ourShader);
-
-
-        model = glm::mat4(1.0f);
-        model = glm::translate(model,glm::vec3(10.0f, -1.01f, -7.0f));
-        model = glm::scale(model, glm::vec3(0.22f));
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        ourShader.setMat4("model", model);
-        tree.Draw(ourShader);
-
-        glCullFace(GL_BACK);
+        {
+            // the lit models' uniforms; the blended pass needs them on the deferred path as well
+            view = programState->camera.GetViewMatrix(alpha);
+            projection = glm::perspective(glm::radians(programState->camera.Zoom), aspect, 0.1f, 100.0f);
+            model = glm::mat4(1.0f);
 
-        model = glm::mat4(1.0f);
-        model = glm::translate(model,glm::vec3(-3.0f, -0.55f, -1.5f));
-        model = glm::scale(model, glm::vec3(0.4f));
-        model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-        ourShader.setMat4("model", model);
-        bridge.Draw(ourShader);
+            ourShader.setMat4("projection", projection);
+            ourShader.setMat4("view", view);
+
+            // directional Light
+            ourShader.setVec3("dirLight.direction", dirLight.direction);
+            ourShader.setVec3("dirLight.ambient", dirLight.ambient);
+            ourShader.setVec3("dirLight.diffuse", dirLight.diffuse);
+            ourShader.setVec3("dirLight.specular", dirLight.specular);
+
+
+            // point light
+            ourShader.setVec3("pointLight.position", pointLight.position);
+            ourShader.setVec3("pointLight.ambient", pointLight.ambient);
+            ourShader.setVec3("pointLight.diffuse", pointLight.diffuse);
+            ourShader.setVec3("pointLight.specular", pointLight.specular);
+            ourShader.setFloat("pointLight.constant", pointLight.constant);
+            ourShader.setFloat("pointLight.linear", pointLight.linear);
+            ourShader.setFloat("pointLight.quadratic", pointLight.quadratic);
+
+            ourShader.setVec3("viewPosition", programState->camera.Position);
+            ourShader.setFloat("material.shininess", 32.0f);
+
+            // view/projection transformations
+            projection = glm::perspective(glm::radians(programState->camera.Zoom), aspect, 0.1f, 100.0f);
+            view = programState->camera.GetViewMatrix(alpha);
+            ourShader.setMat4("projection", projection);
+            ourShader.setMat4("view", view);
+        }
 
-        model = glm::mat4(1.0f);
-        model = glm::translate(model,glm::vec3(-3.0f, -1.01f, -9.0f));
-        model = glm::scale(model, glm::vec3(0.0035f));
-        ourShader.setMat4("model", model);
-        cottage.Draw(ourShader);
+        if (programState->RenderPath != RENDER_DEFERRED) {
+            glDepthFunc(GL_LEQUAL);
+            if (programState->DepthPrepass) {
+                PROFILE_GPU_SCOPE("Depth prepass");
+                depthPrepassShader.setMat4("projection", projection);
+                depthPrepassShader.setMat4("view", view);
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                drawModels(depthPrepassShader, true, ALPHA_OPAQUE | ALPHA_MASKED, nullptr);
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                // every visible fragment has its final depth now, so each pixel is lit once
+                glDepthFunc(GL_EQUAL);
+                glDepthMask(GL_FALSE);
+            }
+            // opaque first: the masked meshes' discarding programs then run only where nothing solid is in front
+            {
+                PROFILE_GPU_SCOPE("Opaque");
+                drawModels(ourShader, false, ALPHA_OPAQUE, nullptr);
+            }
+            {
+                PROFILE_GPU_SCOPE("Masked");
+                drawModels(ourShader, false, ALPHA_MASKED, nullptr);
+            }
+            glDepthMask(GL_TRUE);
+        }
 
-        //background trees
-        for(int i = 0; i<4; i++){
-            model = glm::mat4(1.0f);
-            model = glm::translate(model,glm::vec3(-12.0f + i*7.0f, -1.01f, -12.0f));
-            model = glm::scale(model, glm::vec3(0.08f - i * 0.01 ));
-            model = glm::rotate(model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-            model = glm::rotate(model, glm::radians(i*15.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-            ourShader.setMat4("model", model);
-            trees.Draw(ourShader);
+        {
+            PROFILE_GPU_SCOPE("Skybox");
+            // draw skybox as last
+            skyboxShader.use();
+            skyboxShader.setInt("skybox", 0);
+
+            glDepthMask(GL_FALSE);
+            glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
+            skyboxShader.use();
+            view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
+            skyboxShader.setMat4("view", view);
+            skyboxShader.setMat4("projection", projection);
+            // skybox cube
+            glBindVertexArray(skyboxVAO);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+            glDrawArrays(GL_TRIANGLES, 0, 36);
+            RenderStats::Get().AddDraw(36);
+            glBindVertexArray(0);
+            glDepthMask(GL_TRUE);
+            glDepthFunc(GL_LESS); // set depth function back to default
+        }
 
+        // everything that blends, over the finished solid scene and the sky
+        view = programState->camera.GetViewMatrix(alpha);
+        {
+            PROFILE_GPU_SCOPE("Grass");
+            // graw grass
+            glEnable(GL_BLEND);
+            glDepthMask(GL_FALSE);
+            grassShader.use();
+            grassShader.setMat4("projection", projection);
+            grassShader.setMat4("view", view);
             model = glm::mat4(1.0f);
-            model = glm::translate(model,glm::vec3(-12.0f, -1.01f, -12.0f + i*7.0f));
-            model = glm::scale(model, glm::vec3(0.08f - i * 0.01));
-            model = glm::rotate(model, glm::radians(90.0f), glm::vec3(1.0f, 0.0f, 0.0f));
-            model = glm::rotate(model, glm::radians(i*15.0f), glm::vec3(0.0f, 0.0f, 1.0f));
-            ourShader.setMat4("model", model);
-            trees.Draw(ourShader);
+            grassShader.setMat4("model", model);
+            glBindVertexArray(grassVAO);
+            glBindTexture(GL_TEXTURE_2D, grassTexture);
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
+            RenderStats::Get().AddDraw(6);
+            glDepthMask(GL_TRUE);
+            glDisable(GL_BLEND);
+        }
+        {
+            PROFILE_GPU_SCOPE("Blended");
+            blendedDraws.clear();
+            drawModels(ourShader, false, ALPHA_BLENDED, &blendedDraws);
+            drawBlended(ourShader, view);
         }
 
+        if (debugViews.View != DEBUG_VIEW_NONE) {
+            PROFILE_GPU_SCOPE("Debug view");
+            // the lit models again, into the heatmap target and with the lit pass' depth state
+            view = programState->camera.GetViewMatrix(alpha);
+            debugViews.Resize(dynamicResolution.Width, dynamicResolution.Height);
+            debugViews.Begin();
+            glDepthFunc(GL_LEQUAL);
+            bool prepass = programState->DepthPrepass && programState->RenderPath != RENDER_DEFERRED;
+            if (prepass) {
+                depthPrepassShader.setMat4("projection", projection);
+                depthPrepassShader.setMat4("view", view);
+                glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+                drawModels(depthPrepassShader, true, ALPHA_OPAQUE | ALPHA_MASKED, nullptr);
+                glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+                glDepthFunc(GL_EQUAL);
+                glDepthMask(GL_FALSE);
+            }
+            heatmapShader.IgnoredFeatures = prepass ? FEATURE_ALPHA_TEST : 0;
+            heatmapShader.ForEach([&](Shader &shader) {
+                lightClusters.Bind(shader, dynamicResolution.RenderWidth, dynamicResolution.RenderHeight);
+                shader.setInt("debugView", debugViews.View);
+                shader.setMat4("projection", projection);
+                shader.setMat4("view", view);
+            });
+            drawModels(heatmapShader, false, ALPHA_OPAQUE | ALPHA_MASKED, nullptr);
+            // blended meshes count where they are drawn, without hiding each other; they are not in the prepass, so
+            // they get the lit blended pass' depth test and keep their alpha test
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_FALSE);
+            heatmapShader.IgnoredFeatures = 0;
+            drawModels(heatmapShader, false, ALPHA_BLENDED, nullptr);
+            glDepthMask(GL_TRUE);
+            glDepthFunc(GL_LESS);
+            debugViews.End(heatmapResolveShader);
+        }
 
+        {
+            PROFILE_GPU_SCOPE("Upscale");
+            dynamicResolution.End();
+        }
 
+        {
+            PROFILE_SCOPE("Texture streaming");
+            // the streamed mips get what the GPU budget leaves once everything that cannot shrink is counted
+            size_t fixedBytes = registry.GpuBytes() - textureStreamer.StreamedBytes;
+            textureStreamer.Budget = std::min(STREAMING_BUDGET, registry.Budget > fixedBytes ? registry.Budget - fixedBytes : 0);
+            textureStreamer.Update();
+            if (textureStreamer.Pending() > 0)
+                idleMonitor.RequestRedraw();   // the next frames upload what is being decoded
+        }
 
-        glDisable(GL_CULL_FACE);
+        if (golden.Enabled && golden.CaptureFrame(goldenFrame)) {
+            // the scene without ImGui; the copy finishes in the background while the next views render
+            while (!readback.Request(0, 0, framebufferWidth, framebufferHeight, goldenFrame / GOLDEN_SETTLE_FRAMES))
+                readback.Collect(checkGolden, true);
+        }
 
-        // draw skybox as last
-        skyboxShader.use();
-        skyboxShader.setInt("skybox", 0);
+        if (programState->ImGuiEnabled) {
+            PROFILE_GPU_SCOPE("ImGui");
+            DrawImGui(programState);
+        }
 
-        glDepthMask(GL_FALSE);
-        glDepthFunc(GL_LEQUAL);  // change depth function so depth test passes when values are equal to depth buffer's content
-        skyboxShader.use();
-        view = glm::mat4(glm::mat3(programState->camera.GetViewMatrix())); // remove translation from the view matrix
-        skyboxShader.setMat4("view", view);
-        skyboxShader.setMat4("projection", projection);
-        // skybox cube
-        glBindVertexArray(skyboxVAO);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
-        glBindVertexArray(0);
-        glDepthMask(GL_TRUE);
-        glDepthFunc(GL_LESS); // set depth function back to default
+        {
+            PROFILE_SCOPE("Capture");
+            FrameCapture& frameCapture = programState->frameCapture;
+            frameCapture.Update(framebufferWidth, framebufferHeight);
+            // sequences need a new frame every iteration, readbacks in flight need one to be collected
+            if (frameCapture.Busy())
+                idleMonitor.RequestRedraw();
+        }
 
-        if (programState->ImGuiEnabled)
-            DrawImGui(programState);
+        // the frame's stream data is reused once the GPU is past this point
+        StreamBuffer::Get().EndFrame();
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
+        {
+            PROFILE_SCOPE("Swap");
+            glfwSwapBuffers(window);
+        }
+        framePacer.Wait();
         glfwPollEvents();
+        PROFILE_END_FRAME();
+
+        if (golden.Enabled) {
+            readback.Collect(checkGolden);
+            goldenFrame++;
+        }
+
+        if (benchmark.Enabled) {
+            // wait for the GPU so the measured time covers the whole frame, not just command submission
+            glFinish();
+            if (benchmarkFrame >= BENCHMARK_WARMUP_FRAMES)
+                benchmarkReport.AddFrame((float) ((glfwGetTime() - frameStart) * 1000.0),
+                                         RenderStats::Get().DrawCalls, RenderStats::Get().Triangles);
+            if (benchmarkFrame >= BENCHMARK_WARMUP_FRAMES && programState->debugViews.View != DEBUG_VIEW_NONE)
+                benchmarkReport.AddShading(DEBUG_VIEW_KEYS[programState->debugViews.View],
+                                           programState->debugViews.Mean, programState->debugViews.Max);
+            if (++benchmarkFrame >= BENCHMARK_WARMUP_FRAMES + benchmark.Frames && replayPath.empty())
+                break;
+        }
     }
 
-    programState->SaveToFile("resources/program_state.txt");
+    inputRecorder.Stop();
+
+    int exitCode = 0;
+    if (benchmark.Enabled) {
+        std::string renderer = (const char *) glGetString(GL_RENDERER);
+        if (!benchmarkReport.Write(benchmark.Output, renderer, benchmark.Width, benchmark.Height))
+            exitCode = 1;
+        else
+            std::cout << "Benchmark results written to " << benchmark.Output << std::endl;
+        if (!benchmark.Baseline.empty() && !benchmarkReport.CompareWithBaseline(benchmark.Baseline, renderer, benchmark.Tolerance))
+            exitCode = 1;
+    }
+    if (golden.Enabled) {
+        readback.Collect(checkGolden, true);
+        std::cout << "Golden images: " << golden.Checked - std::min(golden.Failed, golden.Checked) << " of "
+                  << golden.Views.size() << " views passed" << std::endl;
+        if (!golden.Passed())
+            exitCode = 1;
+    }
+
+    if (!offscreen)
+        programState->SaveToFile("resources/program_state.txt");
+    programState->dynamicResolution.Destroy();
+    programState->frameCapture.Shutdown();
+    deferredRenderer.Destroy();
+    programState->lightClusters.Destroy();
+    StreamBuffer::Get().Destroy();
+    programState->shadows.Destroy();
+    programState->ibl.Destroy();
+    programState->debugViews.Destroy();
+    readback.Destroy();
+    PROFILE_SHUTDOWN();
     delete programState;
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplGlfw_Shutdown();
@@ -739,23 +1333,53 @@ int main() {
     // glfw: terminate, clearing all previously allocated GLFW resources.
     // ------------------------------------------------------------------
     glfwTerminate();
-    return 0;
+    return exitCode;
 }
 
-// process all input: query GLFW whether relevant keys are pressed/released this frame and react accordingly
+// process all input: query GLFW whether relevant keys are pressed/released this step and collect the mouse
+// movement gathered since the previous step
 // ---------------------------------------------------------------------------------------------------------
-void processInput(GLFWwindow *window) {
+InputStep processInput(GLFWwindow *window) {
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
 
+    InputStep step;
     if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(FORWARD, deltaTime);
+        step.Flags |= INPUT_FORWARD;
     if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(BACKWARD, deltaTime);
+        step.Flags |= INPUT_BACKWARD;
     if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(LEFT, deltaTime);
+        step.Flags |= INPUT_LEFT;
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        programState->camera.ProcessKeyboard(RIGHT, deltaTime);
+        step.Flags |= INPUT_RIGHT;
+    if (pendingMouseX != 0.0f || pendingMouseY != 0.0f) {
+        step.Flags |= INPUT_HAS_MOUSE;
+        step.MouseX = pendingMouseX;
+        step.MouseY = pendingMouseY;
+    }
+    if (pendingScroll != 0.0f) {
+        step.Flags |= INPUT_HAS_SCROLL;
+        step.Scroll = pendingScroll;
+    }
+    pendingMouseX = pendingMouseY = pendingScroll = 0.0f;
+    return step;
+}
+
+// advances the camera by one simulation step; live, recorded and replayed input all go through here
+// ---------------------------------------------------------------------------------------------------------
+void applyInput(const InputStep &step, float timestep) {
+    if (step.Flags & INPUT_FORWARD)
+        programState->camera.ProcessKeyboard(FORWARD, timestep);
+    if (step.Flags & INPUT_BACKWARD)
+        programState->camera.ProcessKeyboard(BACKWARD, timestep);
+    if (step.Flags & INPUT_LEFT)
+        programState->camera.ProcessKeyboard(LEFT, timestep);
+    if (step.Flags & INPUT_RIGHT)
+        programState->camera.ProcessKeyboard(RIGHT, timestep);
+    if (step.Flags & INPUT_HAS_MOUSE)
+        programState->camera.ProcessMouseMovement(step.MouseX, step.MouseY);
+    if (step.Flags & INPUT_HAS_SCROLL)
+        programState->camera.ProcessMouseScroll(step.Scroll);
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -764,6 +1388,9 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
     // make sure the viewport matches the new window dimensions; note that width and
     // height will be significantly larger than specified on retina displays.
     glViewport(0, 0, width, height);
+    framebufferWidth = width;
+    framebufferHeight = height;
+    programState->idleMonitor.RequestRedraw();
 }
 
 // glfw: whenever the mouse moves, this callback is called
@@ -781,14 +1408,30 @@ void mouse_callback(GLFWwindow *window, double xpos, double ypos) {
     lastX = xpos;
     lastY = ypos;
 
-    if (programState->CameraMouseMovementUpdateEnabled)
-        programState->camera.ProcessMouseMovement(xoffset, yoffset);
+    programState->idleMonitor.RequestRedraw();
+    if (programState->CameraMouseMovementUpdateEnabled) {
+        pendingMouseX += xoffset;
+        pendingMouseY += yoffset;
+    }
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
 // ----------------------------------------------------------------------
 void scroll_callback(GLFWwindow *window, double xoffset, double yoffset) {
-    programState->camera.ProcessMouseScroll(yoffset);
+    pendingScroll += yoffset;
+    programState->idleMonitor.RequestRedraw();
+}
+
+// glfw: whenever a mouse button is pressed or released, this callback is called
+// -----------------------------------------------------------------------------
+void mouse_button_callback(GLFWwindow *window, int button, int action, int mods) {
+    programState->idleMonitor.RequestRedraw();
+}
+
+// glfw: whenever the window contents need to be redrawn (exposed, restored), this callback is called
+// --------------------------------------------------------------------------------------------------
+void window_refresh_callback(GLFWwindow *window) {
+    programState->idleMonitor.RequestRedraw();
 }
 
 void DrawImGui(ProgramState *programState) {
@@ -806,11 +1449,213 @@ void DrawImGui(ProgramState *programState) {
         ImGui::End();
     }
 
+    {
+        ImGui::Begin("Frame pacing");
+        FramePacer& p = programState->framePacer;
+        int mode = p.Mode;
+        if (ImGui::Combo("Mode", &mode, FRAME_PACING_NAMES, IM_ARRAYSIZE(FRAME_PACING_NAMES)))
+            p.Mode = (Frame_Pacing) mode;
+        if (p.Mode == PACING_ADAPTIVE_VSYNC && !FramePacer::AdaptiveVSyncSupported())
+            ImGui::Text("Adaptive vsync not supported, using vsync");
+        float targetFps = p.TargetFps;
+        if (ImGui::DragFloat("Target FPS", &targetFps, 1.0f, 10.0f, 480.0f, "%.0f"))
+            p.TargetFps = targetFps;
+        ImGui::Checkbox("Render on demand", &programState->IdleRenderingEnabled);
+        ImGui::Text("Frame time: %.2f ms avg, %.2f ms jitter", p.AverageMs, p.JitterMs);
+        ImGui::PlotLines("Frame times", p.History.data(), p.History.size(), 0, NULL, 0.0f, 50.0f, ImVec2(0, 60));
+        ImGui::PlotHistogram("Histogram (ms)", p.Histogram.data(), p.Histogram.size(), 0, NULL, 0.0f, FLT_MAX, ImVec2(0, 60));
+        if (ImGui::Button("Reset statistics"))
+            p.ResetStatistics();
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Dynamic resolution");
+        DynamicResolution& d = programState->dynamicResolution;
+        ImGui::Checkbox("Enabled", &d.Enabled);
+        ImGui::DragFloat("GPU budget (ms)", &d.TargetMs, 0.1f, 1.0f, 100.0f);
+        ImGui::Text("Scene GPU time: %.2f ms", d.LastGpuMs);
+        ImGui::Text("Scale: %.3f (%d x %d of %d x %d)", d.Enabled ? d.Scale : 1.0f, d.RenderWidth, d.RenderHeight, d.Width, d.Height);
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Textures");
+        TextureStreamer& t = TextureStreamer::Get();
+        if (t.Enabled) {
+            ImGui::Text("Streamed textures: %u, loading: %u", t.Count(), t.Pending());
+            ImGui::Text("Budget for streamed mips: %.1f MB", t.Budget / 1048576.0);
+            ImGui::Text("Resident: %.1f MB, streamed mips: %.1f MB", t.ResidentBytes / 1048576.0, t.StreamedBytes / 1048576.0);
+            ImGui::Text("Mip loads: %u, levels evicted: %u", t.Loads, t.Evictions);
+        } else
+            ImGui::Text("Streaming off, every mip is resident");
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Memory");
+        ResourceRegistry& r = ResourceRegistry::Get();
+        int budgetMb = (int) (r.Budget >> 20);
+        if (ImGui::SliderInt("GPU budget (MB)", &budgetMb, 64, 4096))
+            r.Budget = (size_t) budgetMb << 20;
+        ImGui::Text("GPU: %.1f of %.1f MB%s", r.GpuBytes() / 1048576.0, r.Budget / 1048576.0,
+                    r.GpuBytes() > r.Budget ? " (over budget)" : "");
+        for (int kind = 0; kind < RESOURCE_KIND_COUNT; kind++)
+            ImGui::Text("%s: %.1f MB", RESOURCE_KIND_NAMES[kind], r.Total((Resource_Kind) kind) / 1048576.0);
+        const StreamBuffer& stream = StreamBuffer::Get();
+        ImGui::Text("Stream buffer: %.0f of %.0f KB in flight, %s, grown %u times", stream.Used() / 1024.0,
+                    stream.Size / 1024.0, stream.Persistent ? "persistent" : "mapped per write", stream.Grown);
+        if (stream.Overflows > 0)
+            ImGui::Text("Stream buffer: %u writes did not fit its %.0f KB limit", stream.Overflows, stream.MaxSize / 1024.0);
+
+        ImGuiTableFlags flags = ImGuiTableFlags_Sortable | ImGuiTableFlags_RowBg | ImGuiTableFlags_Borders |
+                                ImGuiTableFlags_Resizable | ImGuiTableFlags_ScrollY;
+        if (ImGui::BeginTable("Resources", 3, flags, ImVec2(0.0f, 300.0f))) {
+            ImGui::TableSetupScrollFreeze(0, 1);
+            ImGui::TableSetupColumn("Kind");
+            ImGui::TableSetupColumn("Owner");
+            ImGui::TableSetupColumn("Size (KB)", ImGuiTableColumnFlags_DefaultSort | ImGuiTableColumnFlags_PreferSortDescending);
+            ImGui::TableHeadersRow();
+
+            std::vector<ResourceRegistry::Resource> resources = r.List();
+            const ImGuiTableSortSpecs* sort = ImGui::TableGetSortSpecs();
+            if (sort && sort->SpecsCount > 0) {
+                int column = sort->Specs[0].ColumnIndex;
+                bool ascending = sort->Specs[0].SortDirection == ImGuiSortDirection_Ascending;
+                std::stable_sort(resources.begin(), resources.end(),
+                                 [column, ascending](const ResourceRegistry::Resource &a, const ResourceRegistry::Resource &b) {
+                    bool less = column == 0 ? a.Kind < b.Kind : column == 1 ? a.Owner < b.Owner : a.Bytes < b.Bytes;
+                    bool greater = column == 0 ? b.Kind < a.Kind : column == 1 ? b.Owner < a.Owner : b.Bytes < a.Bytes;
+                    return ascending ? less : greater;
+                });
+            }
+            for (const ResourceRegistry::Resource& resource : resources) {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(RESOURCE_KIND_NAMES[resource.Kind]);
+                ImGui::TableSetColumnIndex(1);
+                ImGui::TextUnformatted(resource.Owner.c_str());
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%.1f", resource.Bytes / 1024.0);
+            }
+            ImGui::EndTable();
+        }
+        // scratch of the model imports, every arena allocation past the blocks' own is one malloc avoided
+        for (const ResourceRegistry::Import& import : r.Imports())
+            ImGui::Text("Import %s: %u allocations, %u avoided, %.1f MB peak", import.Owner.c_str(), import.Allocations,
+                        import.Allocations - import.SystemAllocations, import.PeakBytes / 1048576.0);
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Lighting");
+        int renderPath = programState->RenderPath;
+        if (ImGui::Combo("Render path", &renderPath, RENDER_PATH_NAMES, RENDER_PATH_COUNT))
+            programState->RenderPath = (Render_Path) renderPath;
+        ImGui::SliderInt("Scene lights", &programState->SceneLightCount, 0, 1000);
+        if (programState->RenderPath != RENDER_DEFERRED)
+            ImGui::Checkbox("Depth prepass", &programState->DepthPrepass);
+        DebugViews& debugViews = programState->debugViews;
+        int debugView = debugViews.View;
+        if (ImGui::Combo("Debug view", &debugView, DEBUG_VIEW_NAMES, DEBUG_VIEW_COUNT))
+            debugViews.View = (Debug_View) debugView;
+        if (debugViews.View != DEBUG_VIEW_NONE)
+            ImGui::Text("%s: mean %.2f, max %.0f (hottest at %.0f)", DEBUG_VIEW_NAMES[debugViews.View], debugViews.Mean,
+                        debugViews.Max, DEBUG_VIEW_RANGES[debugViews.View]);
+        if (programState->RenderPath == RENDER_FORWARD)
+            ImGui::Text("The forward path shades the main point light only");
+        if (programState->RenderPath == RENDER_CLUSTERED) {
+            const LightClusters& clusters = programState->lightClusters;
+            ImGui::Text("Light indices: %u, busiest cluster: %u lights", clusters.LightIndexCount, clusters.MaxClusterLights);
+            if (clusters.DroppedIndices > 0 || clusters.OwnBuffers)
+                ImGui::Text("Over the buffer texture limit: %u indices dropped%s", clusters.DroppedIndices,
+                            clusters.OwnBuffers ? ", lists in their own buffers" : "");
+        }
+        ShadowCascades& shadows = programState->shadows;
+        ImGui::DragFloat3("Sun direction", (float*)&programState->dirLight.direction, 0.01f, -1.0f, 1.0f);
+        ImGui::Checkbox("Shadows", &shadows.Enabled);
+        ImGui::Checkbox("Cache static shadows", &shadows.CacheEnabled);
+        ImGui::Text("Shadow cascades rendered this frame: %d of %d", shadows.RenderedCascades, SHADOW_CASCADES);
+        ImageBasedLighting& ibl = programState->ibl;
+        ImGui::Checkbox("Sky lighting", &ibl.Enabled);
+        ImGui::SliderFloat("Sky intensity", &ibl.Intensity, 0.0f, 2.0f);
+        if (ibl.FromCache)
+            ImGui::Text("Sky lighting loaded from the cache");
+        else
+            ImGui::Text("Sky lighting baked in %.1f ms", ibl.BakeMs);
+        ImGui::End();
+    }
+
+    {
+        ImGui::Begin("Capture");
+        FrameCapture& c = programState->frameCapture;
+        if (ImGui::Button("Screenshot (F12)"))
+            c.Screenshot();
+        ImGui::SameLine();
+        if (ImGui::Button(c.SequenceLeft() > 0 ? "Stop sequence (F11)" : "Record sequence (F11)"))
+            c.ToggleSequence(c.SequenceFrames);
+        int sequenceFrames = (int) c.SequenceFrames;
+        if (ImGui::DragInt("Sequence frames", &sequenceFrames, 1.0f, 1, 10000))
+            c.SequenceFrames = (unsigned int) sequenceFrames;
+        ImGui::Text("Saved: %u  Dropped: %u  Queued: %u", c.Saved.load(), c.Dropped, c.Queued());
+        ImGui::End();
+    }
+
+#ifdef ENABLE_PROFILER
+    {
+        ImGui::Begin("Profiler");
+        Profiler& profiler = Profiler::Get();
+        if (ImGui::Button("Dump trace (120 frames)") && !profiler.Tracing())
+            profiler.StartTrace("profile_trace.json", 120);
+        if (profiler.Tracing())
+            ImGui::Text("Recording trace...");
+        ImGui::Columns(3, "profiler");
+        ImGui::Text("Scope");
+        ImGui::NextColumn();
+        ImGui::Text("CPU (ms)");
+        ImGui::NextColumn();
+        ImGui::Text("GPU (ms)");
+        ImGui::NextColumn();
+        ImGui::Separator();
+        // rows are in scope order with their nesting depth; a row is collapsed together with all deeper rows after it
+        int collapsedDepth = INT_MAX;
+        for (size_t i = 0; i < profiler.Results.size(); i++) {
+            const ProfileResult& r = profiler.Results[i];
+            if (r.Depth > collapsedDepth)
+                continue;
+            collapsedDepth = INT_MAX;
+            bool hasChildren = i + 1 < profiler.Results.size() && profiler.Results[i + 1].Depth > r.Depth;
+            ImGui::PushID((int) i);
+            float indent = r.Depth * ImGui::GetStyle().IndentSpacing;
+            if (indent > 0.0f)
+                ImGui::Indent(indent);
+            bool open = ImGui::TreeNodeEx(r.Name, ImGuiTreeNodeFlags_DefaultOpen | ImGuiTreeNodeFlags_NoTreePushOnOpen |
+                                                  (hasChildren ? 0 : ImGuiTreeNodeFlags_Leaf));
+            if (indent > 0.0f)
+                ImGui::Unindent(indent);
+            ImGui::PopID();
+            if (!open)
+                collapsedDepth = r.Depth;
+            ImGui::NextColumn();
+            ImGui::Text("%.3f", r.CpuMs);
+            ImGui::NextColumn();
+            if (r.GpuMs >= 0.0f)
+                ImGui::Text("%.3f", r.GpuMs);
+            else
+                ImGui::Text("-");
+            ImGui::NextColumn();
+        }
+        ImGui::Columns(1);
+        ImGui::End();
+    }
+#endif
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
+    programState->idleMonitor.RequestRedraw();
     if (key == GLFW_KEY_F1 && action == GLFW_PRESS) {
         programState->ImGuiEnabled = !programState->ImGuiEnabled;
         if (programState->ImGuiEnabled) {
@@ -820,6 +1665,12 @@ void key_callback(GLFWwindow *window, int key, int scancode, int action, int mod
             glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
         }
     }
+    if (key == GLFW_KEY_F12 && action == GLFW_PRESS)
+        programState->frameCapture.Screenshot();
+    if (key == GLFW_KEY_F11 && action == GLFW_PRESS)
+        programState->frameCapture.ToggleSequence(programState->frameCapture.SequenceFrames);
+    if (key == GLFW_KEY_F5 && action == GLFW_PRESS)
+        shaderReloadRequested = true;
 }
 
 // utility function for loading a 2D texture from file
@@ -842,8 +1693,11 @@ unsigned int loadTexture(char const * path)
             format = GL_RGBA;
 
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        MipChain chain;
+        chain.Generate(path, data, width, height, nrComponents, false);
+        chain.Upload(data, format, format);
+        ResourceRegistry::Get().Track(RESOURCE_TEXTURE, textureID,
+                                      ResourceRegistry::TextureBytes(width, height, nrComponents, true), path);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -877,12 +1731,14 @@ unsigned int loadCubemap(vector<std::string> faces)
     glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
     int width, height, nrChannels;
+    size_t bytes = 0;
     for (unsigned int i = 0; i < faces.size(); i++)
     {
         unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
         if (data)
         {
             glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
+            bytes += ResourceRegistry::TextureBytes(width, height, 3);
             stbi_image_free(data);
         }
         else
@@ -896,6 +1752,7 @@ unsigned int loadCubemap(vector<std::string> faces)
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+    ResourceRegistry::Get().Track(RESOURCE_TEXTURE, textureID, bytes, "Skybox cubemap");
 
     return textureID;
 }
@@ -922,8 +1779,12 @@ unsigned int loadTextureParallax(char const * path, bool gammaCorrection)
             dataFormat = GL_RGBA;
         }
         glBindTexture(GL_TEXTURE_2D, textureID);
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        // sRGB data is filtered in linear space
+        MipChain chain;
+        chain.Generate(path, data, width, height, nrComponents, internalFormat == GL_SRGB || internalFormat == GL_SRGB_ALPHA);
+        chain.Upload(data, internalFormat, dataFormat);
+        ResourceRegistry::Get().Track(RESOURCE_TEXTURE, textureID,
+                                      ResourceRegistry::TextureBytes(width, height, nrComponents, true), path);
 
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
@@ -1021,6 +1882,7 @@ void renderQuad() {
         glBindVertexArray(quadVAO);
         glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
         glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+        ResourceRegistry::Get().Track(RESOURCE_BUFFER, quadVBO, sizeof(quadVertices), "Parallax quad vertices");
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 14 * sizeof(float), (void *) 0);
         glEnableVertexAttribArray(1);